@@ -6,280 +6,498 @@
 
 #include "battleship.h"
 
+/* Fresh starts allowed before a fleet is declared unplaceable */
+#define MAX_FLEET_ATTEMPTS 64
+
+/* Placement counting kernel chosen for this CPU */
+static PlacementKernel placement_kernel = NULL;
+static int placement_kernel_kind = KERNEL_SCALAR;
+
 /* Initialize the Intermediate AI engine */
 void init_intermediate_ai(IntermediateAI* ai) {
-    ai->target_count = 0;
-    ai->hunt_count = 0;
-    ai->targets_fired_count = 0;
+    ai->level = AI_INTERMEDIATE;
     ai->is_targeting = 0;
-    ai->previous_shot[0] = '\0';
+    ai->previous_shot = -1;
+    ai->endgame_budget = 0.0;
+    ai->move_budget = 0.0;
     
     create_targets(ai);
+    init_density_state(&ai->density);
 }
 
-/* Create target and hunt lists */
+/* Initialize the Advanced (probability-density) AI engine */
+void init_advanced_ai(IntermediateAI* ai) {
+    init_intermediate_ai(ai);
+    ai->level = AI_ADVANCED;
+}
+
+/* Let the endgame solver take over once few fleet configurations remain - 0 turns it off */
+void set_endgame_budget(IntermediateAI* ai, double seconds) {
+    ai->endgame_budget = seconds > 0.0 ? seconds : 0.0;
+}
+
+/* Spend seconds per move sampling consistent fleets - 0 leaves every move to the heuristics */
+void set_move_budget(IntermediateAI* ai, double seconds) {
+    ai->move_budget = seconds > 0.0 ? seconds : 0.0;
+}
+
+/* Create target and hunt sets */
 void create_targets(IntermediateAI* ai) {
     int i;
     
-    /* TARGETS: All squares (0-99) */
-    ai->target_count = 0;
-    for (i = 0; i < 100; i++) {
-        ai->targets[ai->target_count++] = i;
-    }
+    mask_clear(&ai->targets);
+    mask_clear(&ai->hunts);
+    mask_clear(&ai->targets_fired);
     
-    /* HUNTING: All even parity squares (checkerboard pattern) */
-    ai->hunt_count = 0;
-    for (i = 1; i < 100; i += 2) {
-        if ((i / 10) % 2 == 0) {
-            ai->hunts[ai->hunt_count++] = i;
-        } else {
-            ai->hunts[ai->hunt_count++] = i - 1;
+    for (i = 0; i < BOARD_CELLS; i++) {
+        /* TARGETS: All squares */
+        mask_set(&ai->targets, i);
+        
+        /* HUNTING: Checkerboard squares, A2 B1 A4 B3 ... */
+        if ((i / BOARD_SIZE + i % BOARD_SIZE) % 2 == 1) {
+            mask_set(&ai->hunts, i);
         }
     }
 }
 
-/* Encode string coordinates to integer (A1 = 0, J10 = 99) */
-int encode_coord(const char* coord) {
-    char row = coord[0];
-    int column;
-    
-    #ifdef _MSC_VER
-    sscanf_s(coord + 1, "%d", &column);
-    #else
-    sscanf(coord + 1, "%d", &column);
-    #endif
+/* Choose a placement counting kernel, falling back to what the CPU supports */
+int select_placement_kernel(int kernel) {
+    if (kernel == KERNEL_AUTO) {
+        kernel = KERNEL_AVX2;
+    }
+    if (kernel == KERNEL_AVX2 && !cpu_has_avx2()) {
+        kernel = KERNEL_SSE2;
+    }
+    if (kernel == KERNEL_SSE2 && !cpu_has_sse2()) {
+        kernel = KERNEL_SCALAR;
+    }
     
-    return (row - 'A') * 10 + column - 1;
+    switch (kernel) {
+        case KERNEL_AVX2:
+            placement_kernel = count_placements_avx2;
+            break;
+        case KERNEL_SSE2:
+            placement_kernel = count_placements_sse2;
+            break;
+        default:
+            kernel = KERNEL_SCALAR;
+            placement_kernel = count_placements_scalar;
+            break;
+    }
+    placement_kernel_kind = kernel;
+    return kernel;
 }
 
-/* Decode integer to string coordinates */
-void decode_coord(int encoded, char* result) {
-    char row = (char)(encoded / 10 + 'A');
-    int column = encoded % 10 + 1;
-    SAFE_SPRINTF(result, MAX_COORD_LENGTH, "%c%d", row, column);
+/* Name of the active placement counting kernel */
+const char* placement_kernel_name(void) {
+    if (placement_kernel == NULL) {
+        select_placement_kernel(KERNEL_AUTO);
+    }
+    switch (placement_kernel_kind) {
+        case KERNEL_AVX2: return "AVX2";
+        case KERNEL_SSE2: return "SSE2";
+        default: return "SCALAR";
+    }
 }
 
-/* Remove value from integer array */
-static void remove_from_array(int* array, int* count, int value) {
-    int i, j;
-    for (i = 0; i < *count; i++) {
-        if (array[i] == value) {
-            for (j = i; j < *count - 1; j++) {
-                array[j] = array[j + 1];
-            }
-            (*count)--;
-            return;
-        }
+/* Count placements of the fleet (ships per length) covering each square */
+void count_placements(const BoardMask* blocked, const int* fleet, int* heat) {
+    if (placement_kernel == NULL) {
+        select_placement_kernel(KERNEL_AUTO);
     }
+    placement_kernel(blocked, fleet, heat);
 }
 
-/* Check if value exists in array */
-static int contains_value(int* array, int count, int value) {
-    int i;
-    for (i = 0; i < count; i++) {
-        if (array[i] == value) {
-            return 1;
-        }
-    }
-    return 0;
+/* Take a square out of every set - it has been fired at */
+static void retire_square(IntermediateAI* ai, int cell) {
+    mask_reset(&ai->targets, cell);
+    mask_reset(&ai->hunts, cell);
+    mask_reset(&ai->targets_fired, cell);
 }
 
-/* Hunt mode - fire at checkerboard pattern squares */
-void hunt_squares(IntermediateAI* ai, char* result, unsigned int* rng_state) {
-    int rand_index, rand_hunt_square;
-    
-    /* Clear targets fired stack */
-    ai->targets_fired_count = 0;
-    
-    /* Pick from hunt list if available */
-    if (ai->hunt_count > 0) {
-        rand_index = random_range(rng_state, 0, ai->hunt_count - 1);
-        rand_hunt_square = ai->hunts[rand_index];
-        remove_from_array(ai->hunts, &ai->hunt_count, rand_hunt_square);
-    } else if (ai->target_count > 0) {
-        /* Fallback to target list */
-        rand_index = random_range(rng_state, 0, ai->target_count - 1);
-        rand_hunt_square = ai->targets[rand_index];
+/* Uniformly random member of a non-empty set */
+static int random_member(const BoardMask* set, RandomStream* rng_state) {
+    return mask_select(set, random_range(rng_state, 0, mask_popcount(set) - 1));
+}
+
+/* Hunting pick - drawn by the placement prior when one is loaded, else uniformly */
+static int hunt_member(const BoardMask* set, RandomStream* rng_state) {
+    int cell = placement_prior_pick(set, rng_state);
+    return cell >= 0 ? cell : random_member(set, rng_state);
+}
+
+/* Hunt mode on bare sets - pick a checkerboard square and retire it, returns the encoded square */
+int hunt_pick(BoardMask* targets, BoardMask* hunts, BoardMask* frontier, RandomStream* rng_state) {
+    int cell;
+    
+    /* Clear targets fired frontier */
+    mask_clear(frontier);
+    STAT_ADD(hunt_shots, 1);
+    
+    if (!mask_is_empty(hunts)) {
+        cell = hunt_member(hunts, rng_state);
+    } else if (!mask_is_empty(targets)) {
+        /* Fallback to target set */
+        cell = hunt_member(targets, rng_state);
     } else {
         /* No squares left - shouldn't happen in normal game */
-        SAFE_STRCPY(result, "A1", MAX_COORD_LENGTH);
-        return;
+        return 0;
     }
     
-    /* Decode to battlefield coordinates */
-    decode_coord(rand_hunt_square, result);
+    mask_reset(targets, cell);
+    mask_reset(hunts, cell);
+    return cell;
+}
+
+/* Hunt mode - pick a checkerboard square, returns the encoded square */
+static int hunt_cell(IntermediateAI* ai, RandomStream* rng_state) {
+    return hunt_pick(&ai->targets, &ai->hunts, &ai->targets_fired, rng_state);
+}
+
+/* Squares around a square, in the order the old target stack pushed them - returns how many */
+static int square_neighbours(int cell, int* neighbours) {
+    int row = cell / BOARD_SIZE;
+    int col = cell % BOARD_SIZE;
+    int count = 0;
     
-    /* Remove from targets list */
-    remove_from_array(ai->targets, &ai->target_count, rand_hunt_square);
+    if (row > 0) neighbours[count++] = cell - BOARD_SIZE;
+    if (row < BOARD_SIZE - 1) neighbours[count++] = cell + BOARD_SIZE;
+    if (col < BOARD_SIZE - 1) neighbours[count++] = cell + 1;
+    if (col > 0) neighbours[count++] = cell - 1;
+    return count;
 }
 
-/* Target mode - fire at squares adjacent to hit */
-void target_ship(IntermediateAI* ai, const char* previous_shot, int is_hit, char* result) {
-    int starting_target = encode_coord(previous_shot);
-    int north, south, east, west;
-    int coordinate_to_fire;
-    
-    /* Calculate positions around the target */
-    north = starting_target - 10;
-    south = starting_target + 10;
-    east = starting_target + 1;
-    west = starting_target - 1;
-    
-    /* Add valid adjacent squares to firing stack */
-    if (contains_value(ai->targets, ai->target_count, north) && 
-        !contains_value(ai->targets_fired, ai->targets_fired_count, north) &&
-        north >= 0) {
-        ai->targets_fired[ai->targets_fired_count++] = north;
-    }
-    if (contains_value(ai->targets, ai->target_count, south) && 
-        !contains_value(ai->targets_fired, ai->targets_fired_count, south) &&
-        south < 100) {
-        ai->targets_fired[ai->targets_fired_count++] = south;
-    }
-    if (contains_value(ai->targets, ai->target_count, east) && 
-        !contains_value(ai->targets_fired, ai->targets_fired_count, east) &&
-        (starting_target % 10 != 9)) {
-        ai->targets_fired[ai->targets_fired_count++] = east;
-    }
-    if (contains_value(ai->targets, ai->target_count, west) && 
-        !contains_value(ai->targets_fired, ai->targets_fired_count, west) &&
-        (starting_target % 10 != 0)) {
-        ai->targets_fired[ai->targets_fired_count++] = west;
+/* Target mode - pick a square next to the previous shot, returns the encoded square */
+static int target_cell(IntermediateAI* ai, int previous_shot, RandomStream* rng_state) {
+    int neighbours[4];
+    int count = square_neighbours(previous_shot, neighbours);
+    int i, cell;
+    
+    /* Add untried adjacent squares to the frontier */
+    for (i = 0; i < count; i++) {
+        if (mask_test(&ai->targets, neighbours[i])) {
+            mask_set(&ai->targets_fired, neighbours[i]);
+        }
     }
     
     /* If no valid targets, resume hunt mode */
-    if (ai->targets_fired_count == 0) {
-        hunt_squares(ai, result, NULL);
-        return;
+    if (mask_is_empty(&ai->targets_fired)) {
+        return hunt_cell(ai, rng_state);
     }
     
-    /* Pop from stack (take last element) */
-    coordinate_to_fire = ai->targets_fired[--ai->targets_fired_count];
+    STAT_ADD(target_shots, 1);
+    STAT_FRONTIER(mask_popcount(&ai->targets_fired));
     
-    /* Remove from hunt list if present */
-    remove_from_array(ai->hunts, &ai->hunt_count, coordinate_to_fire);
-    remove_from_array(ai->targets, &ai->target_count, coordinate_to_fire);
+    /* Latest neighbours first, like popping the old stack, then anything left */
+    cell = -1;
+    for (i = count - 1; i >= 0 && cell < 0; i--) {
+        if (mask_test(&ai->targets_fired, neighbours[i])) {
+            cell = neighbours[i];
+        }
+    }
+    if (cell < 0) {
+        cell = random_member(&ai->targets_fired, rng_state);
+    }
     
-    decode_coord(coordinate_to_fire, result);
+    retire_square(ai, cell);
+    return cell;
 }
 
-/* AI fires a salvo */
-void ai_fire_salvo(IntermediateAI* ai, char* result, unsigned int* rng_state) {
-    if (ai->is_targeting) {
-        target_ship(ai, ai->previous_shot, 1, result);
+/* Hunt mode - fire at checkerboard pattern squares */
+void hunt_squares(IntermediateAI* ai, char* result, RandomStream* rng_state) {
+    decode_coord(hunt_cell(ai, rng_state), result);
+}
+
+/* Target mode - fire at squares adjacent to hit */
+void target_ship(IntermediateAI* ai, int previous_shot, int is_hit, char* result, RandomStream* rng_state) {
+    decode_coord(target_cell(ai, previous_shot, rng_state), result);
+}
+
+/* Take a shot chosen outside the heuristics */
+static void commit_shot(IntermediateAI* ai, int cell, char* result) {
+    retire_square(ai, cell);
+    density_record_shot(&ai->density, cell);
+    ai->previous_shot = cell;
+    decode_coord(cell, result);
+}
+
+/* Pick the engine's next shot */
+static void fire(IntermediateAI* ai, char* result, RandomStream* rng_state) {
+    int cell;
+    
+    /* Near the end the solver's exact answer replaces both heuristics */
+    if (ai->endgame_budget > 0.0) {
+        density_settle(&ai->density);
+        cell = endgame_shot(&ai->density, ai->endgame_budget);
+        if (cell >= 0) {
+            commit_shot(ai, cell, result);
+            return;
+        }
+    }
+    
+    /* With a move budget, the most-covered square over sampled fleets */
+    if (ai->move_budget > 0.0) {
+        density_settle(&ai->density);
+        cell = montecarlo_shot(&ai->density, ai->move_budget, rng_state);
+        if (cell >= 0) {
+            commit_shot(ai, cell, result);
+            return;
+        }
+    }
+    
+    if (ai->level == AI_ADVANCED) {
+        ai->previous_shot = density_fire(&ai->density, result, rng_state);
+        return;
+    }
+    
+    if (ai->is_targeting && ai->previous_shot >= 0) {
+        ai->previous_shot = target_cell(ai, ai->previous_shot, rng_state);
     } else {
-        hunt_squares(ai, result, rng_state);
+        ai->previous_shot = hunt_cell(ai, rng_state);
+    }
+    density_record_shot(&ai->density, ai->previous_shot);
+    decode_coord(ai->previous_shot, result);
+}
+
+/* AI fires a salvo */
+void ai_fire_salvo(IntermediateAI* ai, char* result, RandomStream* rng_state) {
+    #ifdef INSTRUMENT
+    double started;
+    
+    if (stat_time_move()) {
+        started = monotonic_seconds();
+        fire(ai, result, rng_state);
+        stat_move_latency(monotonic_seconds() - started);
+        return;
     }
+    #endif
+    fire(ai, result, rng_state);
+}
+
+/* Mark the squares around a salvo square */
+static void mark_near(int cell, BoardMask* near) {
+    int neighbours[4];
+    int count = square_neighbours(cell, neighbours);
+    int i;
     
-    SAFE_STRCPY(ai->previous_shot, result, MAX_COORD_LENGTH);
+    for (i = 0; i < count; i++) {
+        mask_set(near, neighbours[i]);
+    }
 }
 
-/* AI manages when its ship is hit */
-void ai_manage_ship_hit(Player* p, IntermediateAI* ai, char row, int col) {
-    int i, j;
-    int found = 0;
+/* Add a salvo square to the list and take it out of every set */
+static void take_salvo_square(IntermediateAI* ai, int cell, int* cells, int* n, BoardMask* near) {
+    cells[(*n)++] = cell;
+    retire_square(ai, cell);
+    mark_near(cell, near);
+}
+
+/* Intermediate salvo - finish wounded ships, then hunt squares apart from each other */
+static int intermediate_salvo(IntermediateAI* ai, int n, int count, int* cells, RandomStream* rng_state) {
+    static const int step_row[4] = { -1, 1, 0, 0 };
+    static const int step_col[4] = { 0, 0, 1, -1 };
+    BoardMask line, frontier, near, candidates;
+    const BoardMask* open = &ai->density.open_hits;
+    uint64_t word;
+    int i, k, hit, row, col, cell, far_row, far_col;
     
-    place_piece(&p->arena, row, col, HIT);
+    mask_clear(&line);
+    mask_clear(&frontier);
+    mask_clear(&near);
+    for (i = 0; i < n; i++) {
+        mark_near(cells[i], &near);
+    }
     
-    for (i = 0; i < NO_OF_SHIPS && !found; i++) {
-        if (i >= p->ship_count) continue;
-        
-        if (is_part_of_ship(&p->ships[i], row, col)) {
-            remove_ship_part(&p->ships[i], row, col);
-            
-            if (is_ship_sunken(&p->ships[i])) {
-                printf("YOU SANK A SHIP!\n");
-                /* Remove ship from array */
-                for (j = i; j < p->ship_count - 1; j++) {
-                    p->ships[j] = p->ships[j + 1];
+    /* Untried squares next to an open hit, and those that extend a line of two */
+    for (i = 0; i < MASK_WORDS; i++) {
+        word = open->w[i];
+        while (word != 0) {
+            hit = i * 64 + lowest_bit(word);
+            word &= word - 1;
+            row = hit / BOARD_SIZE;
+            col = hit % BOARD_SIZE;
+            for (k = 0; k < 4; k++) {
+                if (row + step_row[k] < 0 || row + step_row[k] >= BOARD_SIZE ||
+                    col + step_col[k] < 0 || col + step_col[k] >= BOARD_SIZE) {
+                    continue;
+                }
+                cell = hit + step_row[k] * BOARD_SIZE + step_col[k];
+                if (!mask_test(&ai->targets, cell)) continue;
+                mask_set(&frontier, cell);
+                far_row = row - step_row[k];
+                far_col = col - step_col[k];
+                if (far_row >= 0 && far_row < BOARD_SIZE && far_col >= 0 && far_col < BOARD_SIZE &&
+                    mask_test(open, far_row * BOARD_SIZE + far_col)) {
+                    mask_set(&line, cell);
                 }
-                p->ship_count--;
-                ai->is_targeting = 0;  /* Stop targeting when ship is sunk */
-            } else {
-                printf("YOU HIT A SHIP!\n");
-                ai->is_targeting = 1;  /* Start targeting mode */
             }
-            found = 1;
         }
     }
+    
+    while (n < count && !mask_is_empty(&line)) {
+        cell = random_member(&line, rng_state);
+        mask_reset(&line, cell);
+        mask_reset(&frontier, cell);
+        take_salvo_square(ai, cell, cells, &n, &near);
+        STAT_ADD(target_shots, 1);
+    }
+    while (n < count && !mask_is_empty(&frontier)) {
+        cell = random_member(&frontier, rng_state);
+        mask_reset(&frontier, cell);
+        take_salvo_square(ai, cell, cells, &n, &near);
+        STAT_ADD(target_shots, 1);
+    }
+    
+    /* Hunt the checkerboard first, keeping off squares next to this salvo's shots */
+    while (n < count && !mask_is_empty(&ai->targets)) {
+        for (i = 0; i < MASK_WORDS; i++) {
+            candidates.w[i] = ai->hunts.w[i] & ~near.w[i];
+        }
+        if (mask_is_empty(&candidates)) candidates = ai->hunts;
+        if (mask_is_empty(&candidates)) {
+            for (i = 0; i < MASK_WORDS; i++) {
+                candidates.w[i] = ai->targets.w[i] & ~near.w[i];
+            }
+        }
+        if (mask_is_empty(&candidates)) candidates = ai->targets;
+        take_salvo_square(ai, hunt_member(&candidates, rng_state), cells, &n, &near);
+        STAT_ADD(hunt_shots, 1);
+    }
+    return n;
 }
 
-/* AI places a ship on the battlefield */
-void ai_place_ship(Player* p, int ship_index, unsigned int* rng_state) {
-    char row_start;
-    int col_start;
-    int horizontal_or_vertical, ne_or_sw;
-    int placement_res;
-    int ship_len = p->ships[ship_index].length;
+/* Advanced salvo - each shot is the hottest square given misses at the ones before it */
+static int advanced_salvo(IntermediateAI* ai, int n, int count, int* cells, RandomStream* rng_state) {
+    DensityState assumed = ai->density;
+    char coord[MAX_COORD_LENGTH];
+    int i, cell;
+    
+    for (i = 0; i < n; i++) {
+        density_record_shot(&assumed, cells[i]);
+    }
+    while (n < count && mask_popcount(&assumed.fired) < BOARD_CELLS) {
+        cell = density_fire(&assumed, coord, rng_state);
+        retire_square(ai, cell);
+        cells[n++] = cell;
+    }
+    return n;
+}
+
+/* Choose a salvo of up to count distinct squares together - returns how many were chosen */
+int ai_choose_salvo(IntermediateAI* ai, int count, int* cells, RandomStream* rng_state) {
+    int n = 0;
+    int cell;
+    
+    if (count > BOARD_CELLS) {
+        count = BOARD_CELLS;
+    }
+    density_settle(&ai->density);
+    
+    /* The solver, when enabled, picks the shot the rest are chosen around */
+    if (count > 0 && ai->endgame_budget > 0.0) {
+        cell = endgame_shot(&ai->density, ai->endgame_budget);
+        if (cell >= 0) {
+            retire_square(ai, cell);
+            cells[n++] = cell;
+        }
+    }
+    
+    if (ai->level == AI_ADVANCED) {
+        n = advanced_salvo(ai, n, count, cells, rng_state);
+    } else {
+        n = intermediate_salvo(ai, n, count, cells, rng_state);
+    }
+    if (n > 0) {
+        ai->previous_shot = cells[n - 1];
+    }
+    return n;
+}
+
+/* Fire a salvo at p without console output - ai, if not NULL, learns from every shot */
+int resolve_salvo(Player* p, IntermediateAI* ai, const int* cells, int count, int* results) {
+    ShotReport report;
+    int hits = 0;
     int i;
-    char row_iter;
     
-    while (1) {
-        /* Generate random starting position */
-        row_start = random_row(rng_state);
-        col_start = random_col(rng_state);
-        
-        /* Decide horizontal or vertical */
-        horizontal_or_vertical = random_range(rng_state, 0, 1);
-        ne_or_sw = random_range(rng_state, 0, 1);
-        
-        if (horizontal_or_vertical == 0) {
-            /* Try horizontal placement */
-            if (ne_or_sw == 0 && col_start - ship_len + 1 >= 1) {
-                /* Left direction */
-                placement_res = is_correct_coordinates(&p->arena, row_start, row_start,
-                    col_start - ship_len + 1, col_start, &p->ships[ship_index]);
-                if (placement_res == VALID_COORD) {
-                    for (i = col_start - ship_len + 1; i <= col_start; i++) {
-                        place_piece(&p->arena, row_start, i, SHIP_PIECE);
-                    }
-                    store_ship_placement(&p->ships[ship_index], row_start, row_start,
-                        col_start - ship_len + 1, col_start);
-                    return;
-                }
-            } else if (ne_or_sw == 1 && col_start + ship_len - 1 <= 10) {
-                /* Right direction */
-                placement_res = is_correct_coordinates(&p->arena, row_start, row_start,
-                    col_start, col_start + ship_len - 1, &p->ships[ship_index]);
-                if (placement_res == VALID_COORD) {
-                    for (i = col_start; i <= col_start + ship_len - 1; i++) {
-                        place_piece(&p->arena, row_start, i, SHIP_PIECE);
-                    }
-                    store_ship_placement(&p->ships[ship_index], row_start, row_start,
-                        col_start, col_start + ship_len - 1);
-                    return;
-                }
-            }
-        } else {
-            /* Try vertical placement */
-            if (ne_or_sw == 0 && row_start - ship_len + 1 >= 'A') {
-                /* Up direction */
-                placement_res = is_correct_coordinates(&p->arena,
-                    (char)(row_start - ship_len + 1), row_start, col_start, col_start,
-                    &p->ships[ship_index]);
-                if (placement_res == VALID_COORD) {
-                    for (row_iter = (char)(row_start - ship_len + 1); row_iter <= row_start; row_iter++) {
-                        place_piece(&p->arena, row_iter, col_start, SHIP_PIECE);
-                    }
-                    store_ship_placement(&p->ships[ship_index],
-                        (char)(row_start - ship_len + 1), row_start, col_start, col_start);
-                    return;
-                }
-            } else if (ne_or_sw == 1 && row_start + ship_len - 1 <= 'J') {
-                /* Down direction */
-                placement_res = is_correct_coordinates(&p->arena, row_start,
-                    (char)(row_start + ship_len - 1), col_start, col_start,
-                    &p->ships[ship_index]);
-                if (placement_res == VALID_COORD) {
-                    for (row_iter = row_start; row_iter <= row_start + ship_len - 1; row_iter++) {
-                        place_piece(&p->arena, row_iter, col_start, SHIP_PIECE);
-                    }
-                    store_ship_placement(&p->ships[ship_index], row_start,
-                        (char)(row_start + ship_len - 1), col_start, col_start);
-                    return;
-                }
+    for (i = 0; i < count; i++) {
+        results[i] = fire_shot(p, ai, cells[i], &report);
+        hits += results[i] == SHOT_HIT || results[i] == SHOT_SUNK;
+    }
+    if (ai != NULL) {
+        density_settle(&ai->density);
+    }
+    return hits;
+}
+
+/* Resolve a hit and update the engine's targeting state without console output */
+int ai_resolve_ship_hit(Player* p, IntermediateAI* ai, int row, int col) {
+    int ship_index = p->ship_at[cell_index(row, col)];
+    int length = ship_index >= 0 ? p->ships[ship_index].length : 0;
+    int result = resolve_ship_hit(p, row, col);
+    
+    /* Stop targeting when ship is sunk, otherwise start targeting mode */
+    ai->is_targeting = (result != SHOT_SUNK);
+    density_record_hit(&ai->density, cell_index(row, col), result == SHOT_SUNK ? length : 0);
+    return result;
+}
+
+/* AI places a ship uniformly at random among its legal placements */
+int ai_place_ship(Player* p, int ship_index, RandomStream* rng_state) {
+    BoardMask horizontal, vertical;
+    int ship_len = p->ships[ship_index].length;
+    int horizontal_count, total, pick, cell;
+    int row, col;
+    
+    /* Bitsets of legal start squares for each orientation */
+    legal_starts(&p->arena.ships, ship_len, &horizontal, &vertical);
+    horizontal_count = mask_popcount(&horizontal);
+    total = horizontal_count + mask_popcount(&vertical);
+    STAT_ADD(ship_placements, 1);
+    
+    if (total == 0) {
+        STAT_ADD(ship_no_room, 1);
+        return NO_ROOM;
+    }
+    
+    pick = random_range(rng_state, 0, total - 1);
+    if (pick < horizontal_count) {
+        cell = mask_select(&horizontal, pick);
+        row = cell_row(cell);
+        col = cell_col(cell);
+        place_ship(p, ship_index, row, row, col, col + ship_len - 1);
+    } else {
+        cell = mask_select(&vertical, pick - horizontal_count);
+        row = cell_row(cell);
+        col = cell_col(cell);
+        place_ship(p, ship_index, row, row + ship_len - 1, col, col);
+    }
+    
+    return VALID_COORD;
+}
+
+/* AI places its whole fleet, starting over if a ship runs out of room */
+int ai_place_fleet(Player* p, RandomStream* rng_state) {
+    return place_fleet(p, ai_place_ship, rng_state);
+}
+
+/* Place the whole fleet one ship at a time with any placement strategy */
+int place_fleet(Player* p, ShipPlacer placer, RandomStream* rng_state) {
+    int attempt, i;
+    
+    for (attempt = 0; attempt < MAX_FLEET_ATTEMPTS; attempt++) {
+        STAT_ADD(fleet_attempts, 1);
+        reset_fleet(p);
+        for (i = 0; i < NO_OF_SHIPS; i++) {
+            if (placer(p, i, rng_state) != VALID_COORD) {
+                break;
             }
         }
-        /* If we didn't return, try again with new random position */
+        if (i == NO_OF_SHIPS) {
+            return VALID_COORD;
+        }
     }
+    
+    /* Fleet does not fit - leave the battlefield empty */
+    reset_fleet(p);
+    return NO_ROOM;
 }
@@ -0,0 +1,296 @@
+/*
+ * batch.c - Batch engine for many simultaneous games
+ * Cross-platform compatible
+ *
+ * A GameBatch holds up to capacity solo games of the Intermediate engine,
+ * each firing at one placed fleet until it is sunk. Rather than a Player
+ * and an IntermediateAI per game, every field is one contiguous array over
+ * the games: fleet, untried, checkerboard and frontier masks, the ship
+ * index of every square, squares left per ship and the targeting state.
+ *
+ * batch_step plays one shot in every live game in three passes. The first
+ * picks the shots with the engine's hunt and target rules, after sorting
+ * the games into a list per rule so neither loop branches on which rule a
+ * game follows. Each game keeps its checkerboard squares in a lazily
+ * shuffled list, and a hunt draws the next one still untried, which picks
+ * uniformly from the untried checkerboard just as hunt_cell does, without
+ * a select per shot. The second
+ * resolves them all in a loop without calls or branches, which the
+ * compiler can unroll and vectorise. The third moves finished games out
+ * and fills their slots from the end, so the live games stay packed in
+ * slots 0 .. live - 1. Every game draws from its own random stream, so a
+ * game plays out the same whichever slot it sits in.
+ */
+
+#include "battleship.h"
+
+/* Ship slots per game - the last one soaks up shots into water */
+#define SHIP_SLOTS (MAX_SHIPS + 1)
+#define WATER_SLOT MAX_SHIPS
+
+/* Neighbour table entries per square - the count, then up to four squares */
+#define NEIGHBOUR_SLOTS 5
+
+/* Allocate a batch for capacity games - returns 0, or -1 if out of memory */
+int batch_init(GameBatch* b, int capacity) {
+    int cell, row, col, count, k;
+    int* entry;
+
+    memset(b, 0, sizeof(GameBatch));
+    b->capacity = capacity;
+    b->cells = BOARD_CELLS;
+    b->afloat = (BoardMask*)calloc((size_t)capacity, sizeof(BoardMask));
+    b->targets = (BoardMask*)calloc((size_t)capacity, sizeof(BoardMask));
+    b->hunts = (BoardMask*)calloc((size_t)capacity, sizeof(BoardMask));
+    b->frontier = (BoardMask*)calloc((size_t)capacity, sizeof(BoardMask));
+    b->ship_at = (unsigned char*)calloc((size_t)capacity * (size_t)b->cells, 1);
+    b->ship_left = (unsigned char*)calloc((size_t)capacity * SHIP_SLOTS, 1);
+    b->previous_shot = (int*)calloc((size_t)capacity, sizeof(int));
+    b->targeting = (unsigned char*)calloc((size_t)capacity, 1);
+    b->shots = (int*)calloc((size_t)capacity, sizeof(int));
+    b->game = (long long*)calloc((size_t)capacity, sizeof(long long));
+    b->rng = (RandomStream*)calloc((size_t)capacity, sizeof(RandomStream));
+    b->shot = (int*)calloc((size_t)capacity, sizeof(int));
+    b->aiming = (int*)calloc((size_t)capacity, sizeof(int));
+    b->hunting = (int*)calloc((size_t)capacity, sizeof(int));
+    b->done_game = (long long*)calloc((size_t)capacity, sizeof(long long));
+    b->done_shots = (int*)calloc((size_t)capacity, sizeof(int));
+    b->hunt_order = (uint16_t*)calloc((size_t)capacity * (size_t)b->cells, sizeof(uint16_t));
+    b->hunt_left = (int*)calloc((size_t)capacity, sizeof(int));
+    b->neighbours = (int*)calloc((size_t)b->cells * NEIGHBOUR_SLOTS, sizeof(int));
+    b->around = (BoardMask*)calloc((size_t)b->cells, sizeof(BoardMask));
+    b->fresh_order = (uint16_t*)calloc((size_t)b->cells, sizeof(uint16_t));
+
+    if (b->afloat == NULL || b->targets == NULL || b->hunts == NULL || b->frontier == NULL ||
+        b->ship_at == NULL || b->ship_left == NULL || b->previous_shot == NULL ||
+        b->targeting == NULL || b->shots == NULL || b->game == NULL || b->rng == NULL ||
+        b->shot == NULL || b->aiming == NULL || b->hunting == NULL || b->done_game == NULL ||
+        b->done_shots == NULL || b->hunt_order == NULL || b->hunt_left == NULL || b->neighbours == NULL ||
+        b->around == NULL || b->fresh_order == NULL) {
+        batch_free(b);
+        return -1;
+    }
+
+    /* Squares around each square, in the order target_cell lists them */
+    for (cell = 0; cell < b->cells; cell++) {
+        row = cell / BOARD_SIZE;
+        col = cell % BOARD_SIZE;
+        entry = &b->neighbours[cell * NEIGHBOUR_SLOTS];
+        count = 0;
+        if (row > 0) entry[1 + count++] = cell - BOARD_SIZE;
+        if (row < BOARD_SIZE - 1) entry[1 + count++] = cell + BOARD_SIZE;
+        if (col < BOARD_SIZE - 1) entry[1 + count++] = cell + 1;
+        if (col > 0) entry[1 + count++] = cell - 1;
+        entry[0] = count;
+        for (k = 1; k <= count; k++) {
+            mask_set(&b->around[cell], entry[k]);
+        }
+    }
+
+    /* Fresh engine sets, the same as create_targets builds */
+    mask_clear(&b->fresh_targets);
+    mask_clear(&b->fresh_hunts);
+    for (cell = 0; cell < b->cells; cell++) {
+        mask_set(&b->fresh_targets, cell);
+        if ((cell / BOARD_SIZE + cell % BOARD_SIZE) % 2 == 1) {
+            mask_set(&b->fresh_hunts, cell);
+            b->fresh_order[b->fresh_count++] = (uint16_t)cell;
+        }
+    }
+    return 0;
+}
+
+/* Release a batch's arrays */
+void batch_free(GameBatch* b) {
+    free(b->afloat);
+    free(b->targets);
+    free(b->hunts);
+    free(b->frontier);
+    free(b->ship_at);
+    free(b->ship_left);
+    free(b->previous_shot);
+    free(b->targeting);
+    free(b->shots);
+    free(b->game);
+    free(b->rng);
+    free(b->shot);
+    free(b->aiming);
+    free(b->hunting);
+    free(b->done_game);
+    free(b->done_shots);
+    free(b->hunt_order);
+    free(b->hunt_left);
+    free(b->neighbours);
+    free(b->around);
+    free(b->fresh_order);
+    memset(b, 0, sizeof(GameBatch));
+}
+
+/* Start a game against a placed fleet, drawing from rng - returns its slot, or -1 if the batch is full */
+int batch_add(GameBatch* b, const Player* fleet, long long game, const RandomStream* rng) {
+    int slot = b->live;
+    int cell, s;
+
+    if (slot >= b->capacity) {
+        return -1;
+    }
+    b->afloat[slot] = fleet->arena.ships;
+    b->targets[slot] = b->fresh_targets;
+    b->hunts[slot] = b->fresh_hunts;
+    mask_clear(&b->frontier[slot]);
+    memcpy(&b->hunt_order[slot * b->cells], b->fresh_order, (size_t)b->fresh_count * sizeof(uint16_t));
+    for (cell = 0; cell < b->cells; cell++) {
+        s = fleet->ship_at[cell];
+        b->ship_at[slot * b->cells + cell] = (unsigned char)(s >= 0 ? s : WATER_SLOT);
+    }
+    for (s = 0; s < SHIP_SLOTS; s++) {
+        b->ship_left[slot * SHIP_SLOTS + s] = (unsigned char)(s < NO_OF_SHIPS ? fleet->ships[s].position_count : 0);
+    }
+    b->hunt_left[slot] = b->fresh_count;
+    b->previous_shot[slot] = -1;
+    b->targeting[slot] = 0;
+    b->shots[slot] = 0;
+    b->game[slot] = game;
+    b->rng[slot] = *rng;
+    b->live++;
+    return slot;
+}
+
+/* Copy every field of one slot over another */
+static void move_slot(GameBatch* b, int to, int from) {
+    b->afloat[to] = b->afloat[from];
+    b->targets[to] = b->targets[from];
+    b->hunts[to] = b->hunts[from];
+    b->frontier[to] = b->frontier[from];
+    memcpy(&b->ship_at[to * b->cells], &b->ship_at[from * b->cells], (size_t)b->cells);
+    memcpy(&b->ship_left[to * SHIP_SLOTS], &b->ship_left[from * SHIP_SLOTS], SHIP_SLOTS);
+    memcpy(&b->hunt_order[to * b->cells], &b->hunt_order[from * b->cells],
+        (size_t)b->hunt_left[from] * sizeof(uint16_t));
+    b->hunt_left[to] = b->hunt_left[from];
+    b->previous_shot[to] = b->previous_shot[from];
+    b->targeting[to] = b->targeting[from];
+    b->shots[to] = b->shots[from];
+    b->game[to] = b->game[from];
+    b->rng[to] = b->rng[from];
+}
+
+/* Hunt pick for one game - the next untried square of its shuffled checkerboard */
+static int hunt_slot(GameBatch* b, int i, int prior) {
+    uint16_t* order = &b->hunt_order[i * b->cells];
+    int left = b->hunt_left[i];
+    int j, cell;
+
+    if (!prior) {
+        mask_clear(&b->frontier[i]);
+        while (left > 0) {
+            /* Squares shot while targeting are dropped as they come up */
+            j = (int)random_below(&b->rng[i], (uint32_t)left);
+            cell = order[j];
+            order[j] = order[--left];
+            if (mask_test(&b->hunts[i], cell)) {
+                b->hunt_left[i] = left;
+                mask_reset(&b->targets[i], cell);
+                mask_reset(&b->hunts[i], cell);
+                return cell;
+            }
+        }
+        b->hunt_left[i] = 0;
+    }
+
+    /* A prior weights the draw, and past the checkerboard any untried square will do */
+    return hunt_pick(&b->targets[i], &b->hunts[i], &b->frontier[i], &b->rng[i]);
+}
+
+/* Target pick for one game - a square next to its previous shot, as target_cell picks */
+static int target_slot(GameBatch* b, int i, int prior) {
+    const int* entry = &b->neighbours[b->previous_shot[i] * NEIGHBOUR_SLOTS];
+    const BoardMask* around = &b->around[b->previous_shot[i]];
+    BoardMask* frontier = &b->frontier[i];
+    int k, cell;
+
+    /* Untried squares around the previous shot join the frontier */
+    for (k = 0; k < MASK_WORDS; k++) {
+        frontier->w[k] |= around->w[k] & b->targets[i].w[k];
+    }
+    if (mask_is_empty(frontier)) {
+        return hunt_slot(b, i, prior);
+    }
+
+    cell = -1;
+    for (k = entry[0]; k >= 1 && cell < 0; k--) {
+        if (mask_test(frontier, entry[k])) {
+            cell = entry[k];
+        }
+    }
+    if (cell < 0) {
+        cell = mask_select(frontier, random_range(&b->rng[i], 0, mask_popcount(frontier) - 1));
+    }
+    mask_reset(&b->targets[i], cell);
+    mask_reset(&b->hunts[i], cell);
+    mask_reset(frontier, cell);
+    return cell;
+}
+
+/* One shot in every live game - finished games move to done_game/done_shots, returns the games still live */
+int batch_step(GameBatch* b) {
+    BoardMask* afloat = b->afloat;
+    const unsigned char* ship_at = b->ship_at;
+    unsigned char* ship_left = b->ship_left;
+    unsigned char* targeting = b->targeting;
+    int* shot = b->shot;
+    int live = b->live;
+    int cells = b->cells;
+    int prior = placement_prior_loaded();
+    int aimed = 0;
+    int hunted = 0;
+    int i, cell, hit, sunk, over, aim;
+    unsigned char* left;
+    uint64_t bit;
+
+    /* Sort - targeting games and hunting games into lists, without a branch per game */
+    for (i = 0; i < live; i++) {
+        aim = targeting[i] & (b->previous_shot[i] >= 0);
+        b->aiming[aimed] = i;
+        b->hunting[hunted] = i;
+        aimed += aim;
+        hunted += !aim;
+    }
+
+    /* Pick - each list by one of the engine's rules, one random stream per game */
+    for (i = 0; i < aimed; i++) {
+        shot[b->aiming[i]] = target_slot(b, b->aiming[i], prior);
+    }
+    for (i = 0; i < hunted; i++) {
+        shot[b->hunting[i]] = hunt_slot(b, b->hunting[i], prior);
+    }
+
+    /* Resolve - branch-free; a miss takes nothing from the water slot */
+    for (i = 0; i < live; i++) {
+        cell = shot[i];
+        bit = (uint64_t)1 << (cell & 63);
+        hit = (afloat[i].w[cell >> 6] & bit) != 0;
+        afloat[i].w[cell >> 6] &= ~bit;
+        left = &ship_left[i * SHIP_SLOTS + ship_at[i * cells + cell]];
+        *left = (unsigned char)(*left - hit);
+        sunk = hit & (*left == 0);
+        targeting[i] = (unsigned char)((targeting[i] & !hit) | (hit & !sunk));
+        b->previous_shot[i] = cell;
+        b->shots[i]++;
+    }
+
+    /* Compact - a finished game's slot takes the last live game */
+    b->done = 0;
+    for (i = live - 1; i >= 0; i--) {
+        over = mask_is_empty(&afloat[i]);
+        if (over || b->shots[i] >= cells) {
+            b->done_game[b->done] = b->game[i];
+            b->done_shots[b->done] = over ? b->shots[i] : -1;
+            b->done++;
+            if (i != --live) {
+                move_slot(b, i, live);
+            }
+        }
+    }
+    b->live = live;
+    return live;
+}
@@ -7,70 +7,82 @@
 
 /* Initialize battlefield with water */
 void init_battlefield(Battlefield* bf) {
-    int i, j;
-    for (i = 0; i < BOARD_SIZE; i++) {
-        for (j = 0; j < BOARD_SIZE; j++) {
-            bf->board[i][j] = WATER;
-        }
+    init_bitboards();
+    mask_clear(&bf->ships);
+    mask_clear(&bf->hits);
+    mask_clear(&bf->misses);
+}
+
+/* Piece shown for a cell - hits and misses take precedence over ships */
+char cell_piece(const Battlefield* bf, int cell) {
+    if (mask_test(&bf->hits, cell)) {
+        return HIT;
+    }
+    if (mask_test(&bf->misses, cell)) {
+        return MISS;
     }
+    if (mask_test(&bf->ships, cell)) {
+        return SHIP_PIECE;
+    }
+    return WATER;
 }
 
 /* Print battlefield - cloaked during wartime, exposed during setup */
 void print_battlefield(Battlefield* bf, int is_wartime) {
-    int i, j;
-    char row_label;
-    
-    printf("\n  ");
-    for (i = 1; i <= BOARD_SIZE; i++) {
-        printf("%d ", i);
-    }
+    char text[BOARD_TEXT_SIZE];
+    size_t length = format_battlefield(bf, is_wartime, text, sizeof(text));
     
-    for (i = 0; i < BOARD_SIZE; i++) {
-        row_label = 'A' + i;
-        printf("\n%c ", row_label);
-        for (j = 0; j < BOARD_SIZE; j++) {
-            if (is_wartime && bf->board[i][j] == SHIP_PIECE) {
-                printf("%c ", WATER);
-            } else {
-                printf("%c ", bf->board[i][j]);
-            }
-        }
-    }
-    printf("\n\n");
+    /* Whole board in one write */
+    fwrite(text, 1, length, stdout);
 }
 
 /* Check if coordinate hits a ship */
-int is_hit(Battlefield* bf, char row, int col) {
+int is_hit(Battlefield* bf, int row, int col) {
     return get_piece(bf, row, col) == SHIP_PIECE;
 }
 
 /* Check if coordinate is a miss */
-int is_miss(Battlefield* bf, char row, int col) {
+int is_miss(Battlefield* bf, int row, int col) {
     return get_piece(bf, row, col) == WATER;
 }
 
 /* Place a piece on the battlefield */
-void place_piece(Battlefield* bf, char row, int col, char piece) {
-    if (row >= 'A' && row <= 'J' && col >= 1 && col <= 10) {
-        bf->board[row - 'A'][col - 1] = piece;
+void place_piece(Battlefield* bf, int row, int col, char piece) {
+    int cell;
+    
+    if (on_board(row, col)) {
+        cell = cell_index(row, col);
+        switch (piece) {
+            case SHIP_PIECE:
+                mask_set(&bf->ships, cell);
+                break;
+            case HIT:
+                mask_set(&bf->hits, cell);
+                break;
+            case MISS:
+                mask_set(&bf->misses, cell);
+                break;
+            default:
+                mask_reset(&bf->ships, cell);
+                mask_reset(&bf->hits, cell);
+                mask_reset(&bf->misses, cell);
+                break;
+        }
     }
 }
 
 /* Get piece at coordinate */
-char get_piece(Battlefield* bf, char row, int col) {
-    if (row >= 'A' && row <= 'J' && col >= 1 && col <= 10) {
-        return bf->board[row - 'A'][col - 1];
+char get_piece(Battlefield* bf, int row, int col) {
+    if (on_board(row, col)) {
+        return cell_piece(bf, cell_index(row, col));
     }
     return WATER;
 }
 
-/* Check if coordinates are valid for ship placement */
-int is_correct_coordinates(Battlefield* bf, char roF, char roS, int coF, int coS, Ship* s) {
+/* Validation code of a placement - see is_correct_coordinates */
+static int check_coordinates(Battlefield* bf, int roF, int roS, int coF, int coS, Ship* s) {
     /* Check for coordinates outside the board */
-    if (roF > 'J' || roF < 'A' || roS > 'J' || roS < 'A') {
-        return OUT_OF_BOARD;
-    }
-    if (coF > 10 || coF < 1 || coS > 10 || coS < 1) {
+    if (!on_board(roF, coF) || !on_board(roS, coS)) {
         return OUT_OF_BOARD;
     }
     
@@ -93,49 +105,42 @@ int is_correct_coordinates(Battlefield* bf, char roF, char roS, int coF, int coS
         }
         
         /* Check if crossing or touching other ships */
-        if (is_crossing(bf, roF, roS, coF, coS)) {
-            return CROSSING;
-        }
-        if (is_touching(bf, roF, roS, coF, coS)) {
-            return TOUCHING;
-        }
+        return placement_is_legal(bf, roF != roS, s->length, cell_index(roF, coF));
     }
     
     return VALID_COORD;
 }
 
+/* Check if coordinates are valid for ship placement */
+int is_correct_coordinates(Battlefield* bf, int roF, int roS, int coF, int coS, Ship* s) {
+    int code = check_coordinates(bf, roF, roS, coF, coS, s);
+    
+    STAT_CHECK(code);
+    return code;
+}
+
 /* Check if ship crosses another ship */
-int is_crossing(Battlefield* bf, char roF, char roS, int coF, int coS) {
-    int i, j;
-    for (i = roF - 'A'; i <= roS - 'A'; i++) {
-        for (j = coF - 1; j <= coS - 1; j++) {
-            if (bf->board[i][j] == SHIP_PIECE) {
-                return 1;
-            }
-        }
-    }
-    return 0;
+int is_crossing(Battlefield* bf, int roF, int roS, int coF, int coS) {
+    BoardMask ship, halo;
+    int vertical = roF != roS;
+    
+    build_line_masks(vertical, vertical ? roS - roF + 1 : coS - coF + 1,
+        cell_index(roF, coF), &ship, &halo);
+    return mask_intersects(&ship, &bf->ships);
 }
 
 /* Check if ship is touching another ship */
-int is_touching(Battlefield* bf, char roF, char roS, int coF, int coS) {
-    int i, j;
-    int start_row = roF - 'A';
-    int end_row = roS - 'A';
-    int start_col = coF - 1;
-    int end_col = coS - 1;
+int is_touching(Battlefield* bf, int roF, int roS, int coF, int coS) {
+    BoardMask ship, halo;
+    int vertical = roF != roS;
+    int i;
     
-    /* Check horizontal adjacency */
-    for (i = start_row; i <= end_row; i++) {
-        /* Check left */
-        if (start_col > 0 && bf->board[i][start_col - 1] == SHIP_PIECE) {
-            return 1;
-        }
-        /* Check right */
-        if (end_col < BOARD_SIZE - 1 && bf->board[i][end_col + 1] == SHIP_PIECE) {
-            return 1;
-        }
-    }
+    build_line_masks(vertical, vertical ? roS - roF + 1 : coS - coF + 1,
+        cell_index(roF, coF), &ship, &halo);
     
-    return 0;
+    /* Only the surrounding squares count, not the ship's own cells */
+    for (i = 0; i < MASK_WORDS; i++) {
+        halo.w[i] &= ~ship.w[i];
+    }
+    return mask_intersects(&halo, &bf->ships);
 }
@@ -13,33 +13,88 @@
     #include <stdlib.h>
     #include <string.h>
     #include <time.h>
+    #include <stdint.h>
 #else
     #define PLATFORM_NAME "WINDOWS"
     #include <stdio.h>
     #include <stdlib.h>
     #include <string.h>
     #include <time.h>
+    #include <stdint.h>
     #ifndef UNIVAC
         #ifdef _MSC_VER
             #include <windows.h>
+            #include <intrin.h>
         #endif
     #endif
 #endif
 
+/*
+ * Board and fleet size
+ *
+ * A default build is specialised for one size: BOARD_SIZE and NO_OF_SHIPS
+ * are constants (-DBOARD_SIZE=N -DNO_OF_SHIPS=N to change them), so every
+ * board loop has a fixed trip count the compiler can unroll. A build with
+ * -DDYNAMIC_BOARD takes the size and fleet at run time through
+ * configure_board, up to MAX_BOARD_SIZE and MAX_SHIPS; arrays are sized
+ * for the maximum and loops run over the configured board only.
+ * The fleet repeats the standard five ships, largest first.
+ */
+#ifdef DYNAMIC_BOARD
+    #ifndef MAX_BOARD_SIZE
+        #define MAX_BOARD_SIZE 100
+    #endif
+    #ifndef MAX_SHIPS
+        #define MAX_SHIPS 64
+    #endif
+    extern int active_board_size;
+    extern int active_ship_count;
+    extern int active_mask_words;
+    #define BOARD_SIZE active_board_size
+    #define NO_OF_SHIPS active_ship_count
+    #define MASK_WORDS active_mask_words
+#else
+    #ifndef BOARD_SIZE
+        #define BOARD_SIZE 10
+    #endif
+    #ifndef NO_OF_SHIPS
+        #define NO_OF_SHIPS 5
+    #endif
+    #define MAX_BOARD_SIZE BOARD_SIZE
+    #define MAX_SHIPS NO_OF_SHIPS
+    #define MASK_WORDS MAX_MASK_WORDS
+#endif
+
 /* Constants */
-#define BOARD_SIZE 10
-#define NO_OF_SHIPS 5
+#define MIN_BOARD_SIZE 5
+#define STANDARD_FLEET 5
 #define MAX_SHIP_LENGTH 5
 #define MAX_NAME_LENGTH 50
 #define MAX_COORD_LENGTH 10
-#define MAX_POSITIONS 100
+#define BOARD_CELLS (BOARD_SIZE * BOARD_SIZE)
+#define MAX_BOARD_CELLS (MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+#define MAX_POSITIONS MAX_BOARD_CELLS
+#define MAX_MASK_WORDS ((MAX_BOARD_CELLS + 63) / 64)
+
+#if MAX_BOARD_SIZE < MIN_BOARD_SIZE || MAX_BOARD_SIZE > 255
+    #error "board size must be between 5 and 255"
+#endif
+#if MAX_SHIPS < 1 || MAX_SHIPS > 127
+    #error "fleet must hold between 1 and 127 ships"
+#endif
+
+/* Bitboard - one bit per cell, cell index is row * BOARD_SIZE + column (0-based) */
+typedef struct {
+    uint64_t w[MAX_MASK_WORDS];
+} BoardMask;
 
 /* Ship types */
 typedef struct {
     char name[MAX_NAME_LENGTH];
     int length;
-    char positions[MAX_SHIP_LENGTH][MAX_COORD_LENGTH];
-    int position_count;
+    int cells[MAX_SHIP_LENGTH];   /* encoded squares, row * BOARD_SIZE + column */
+    BoardMask remaining;          /* squares not yet hit */
+    int position_count;           /* number of squares not yet hit */
 } Ship;
 
 /* Battlefield piece types */
@@ -48,6 +103,12 @@ typedef struct {
 #define MISS 'M'
 #define SHIP_PIECE '0'
 
+/* Shot resolution codes */
+#define SHOT_MISS 0
+#define SHOT_HIT 1
+#define SHOT_SUNK 2
+#define SHOT_REPEAT 3           /* square already fired at */
+
 /* Battlefield validation codes */
 #define VALID_COORD 0x0F
 #define TOUCHING 0x1C
@@ -55,84 +116,713 @@ typedef struct {
 #define OUT_OF_BOARD 0xBD
 #define WRONG_LENGTH 0xFF
 #define MISALIGN 0x4E
+#define NO_ROOM 0x5A
+
+/* Coordinate parse codes - parse_coord also returns VALID_COORD and OUT_OF_BOARD */
+#define NO_ROW 0x2B
+#define NO_COLUMN 0x6C
+#define EXTRA_TEXT 0x7E
 
-/* Battlefield structure */
+/* Battlefield structure - ship, hit and miss occupancy masks */
 typedef struct {
-    char board[BOARD_SIZE][BOARD_SIZE];
+    BoardMask ships;
+    BoardMask hits;
+    BoardMask misses;
 } Battlefield;
 
 /* Player structure */
 typedef struct {
     char name[MAX_NAME_LENGTH];
     Battlefield arena;
-    Ship ships[NO_OF_SHIPS];
-    int ship_count;
+    Ship ships[MAX_SHIPS];
+    int ship_count;                       /* ships still afloat */
+    signed char ship_at[MAX_BOARD_CELLS]; /* ship index per square, -1 for water */
 } Player;
 
+/* AI levels */
+#define AI_INTERMEDIATE 0
+#define AI_ADVANCED 1
+
+/* Probability-density targeting state - what the engine has observed */
+typedef struct {
+    BoardMask fired;        /* every square shot at */
+    BoardMask misses;       /* shots that found water */
+    BoardMask open_hits;    /* hits not yet attributed to a sunk ship */
+    BoardMask sunk;         /* cells of ships known to be sunk */
+    int afloat[MAX_SHIP_LENGTH + 1];  /* remaining ships per length */
+    int pending_cell;       /* last shot, a miss unless a hit is reported */
+} DensityState;
+
 /* AI Engine structures */
 typedef struct {
-    int targets[MAX_POSITIONS];
-    int target_count;
-    int hunts[MAX_POSITIONS];
-    int hunt_count;
-    int targets_fired[MAX_POSITIONS];
-    int targets_fired_count;
+    int level;
     int is_targeting;
-    char previous_shot[MAX_COORD_LENGTH];
+    int previous_shot;          /* encoded square of the last shot, -1 before the first */
+    BoardMask targets;          /* squares not yet fired at */
+    BoardMask hunts;            /* untried squares of the checkerboard */
+    BoardMask targets_fired;    /* target-mode frontier around hits */
+    DensityState density;       /* observations - kept by both levels */
+    double endgame_budget;      /* seconds per endgame move, 0 leaves the endgame to the heuristics */
+    double move_budget;         /* seconds per move for Monte Carlo sampling, 0 turns it off */
 } IntermediateAI;
 
-/* Random number generator state for UNIVAC */
-#ifdef UNIVAC
+/* Random number generator - xoshiro256** state, seeded through SplitMix64 */
 typedef struct {
-    unsigned int state;
-} XorShiftRNG;
+    uint64_t s[4];
+} RandomStream;
+
+/* Inline helpers */
+#ifdef _MSC_VER
+    #define STATIC_INLINE static __inline
+#else
+    #define STATIC_INLINE static inline
+#endif
+
+/* Per-thread storage */
+#ifdef _MSC_VER
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
 #endif
 
+/* Rotate a word left by k bits, 0 < k < 64 */
+STATIC_INLINE uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/* xoshiro256** - next 64 random bits; inline, as every engine draws once a shot */
+STATIC_INLINE uint64_t random_next(RandomStream* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+/* Uniform number in [0, bound) without modulo bias - bound must be non-zero */
+STATIC_INLINE uint32_t random_below(RandomStream* rng, uint32_t bound) {
+    uint64_t m = (random_next(rng) >> 32) * bound;
+    uint32_t low = (uint32_t)m;
+    uint32_t threshold;
+
+    /* Multiply-shift with rejection of the few biased low products */
+    if (low < bound) {
+        threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (random_next(rng) >> 32) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/* Index of the lowest set bit - word must be non-zero */
+STATIC_INLINE int lowest_bit(uint64_t word) {
+    #if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int)index;
+    #elif defined(__GNUC__)
+    return __builtin_ctzll(word);
+    #else
+    int index = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+    #endif
+}
+
+/*
+ * Rows are passed around as row codes, 'A' + row. Codes past 'Z' are not
+ * letters, so they are held in an int and only ever printed through
+ * format_row_label, which writes AA, AB, ... for the rows after Z.
+ */
+
+/* Encoded square of a row code and 1-based column */
+STATIC_INLINE int cell_index(int row, int col) {
+    return (row - 'A') * BOARD_SIZE + col - 1;
+}
+
+/* Row code of an encoded square */
+STATIC_INLINE int cell_row(int cell) {
+    return 'A' + cell / BOARD_SIZE;
+}
+
+/* 1-based column of an encoded square */
+STATIC_INLINE int cell_col(int cell) {
+    return cell % BOARD_SIZE + 1;
+}
+
+/* Non-zero if a row code and 1-based column lie on the board */
+STATIC_INLINE int on_board(int row, int col) {
+    return row >= 'A' && row < 'A' + BOARD_SIZE && col >= 1 && col <= BOARD_SIZE;
+}
+
+/* Number of set bits in a word */
+STATIC_INLINE int popcount64(uint64_t word) {
+    #if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(word);
+    #elif defined(__GNUC__)
+    return __builtin_popcountll(word);
+    #else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((word * 0x0101010101010101ULL) >> 56);
+    #endif
+}
+
+/* Bitboard primitives */
+STATIC_INLINE void mask_clear(BoardMask* m) {
+    int i;
+    for (i = 0; i < MASK_WORDS; i++) m->w[i] = 0;
+}
+
+STATIC_INLINE void mask_set(BoardMask* m, int cell) {
+    m->w[cell >> 6] |= (uint64_t)1 << (cell & 63);
+}
+
+STATIC_INLINE void mask_reset(BoardMask* m, int cell) {
+    m->w[cell >> 6] &= ~((uint64_t)1 << (cell & 63));
+}
+
+STATIC_INLINE int mask_test(const BoardMask* m, int cell) {
+    return (int)((m->w[cell >> 6] >> (cell & 63)) & 1);
+}
+
+STATIC_INLINE void mask_or(BoardMask* dest, const BoardMask* src) {
+    int i;
+    for (i = 0; i < MASK_WORDS; i++) dest->w[i] |= src->w[i];
+}
+
+STATIC_INLINE int mask_is_empty(const BoardMask* m) {
+    uint64_t acc = 0;
+    int i;
+    for (i = 0; i < MASK_WORDS; i++) acc |= m->w[i];
+    return acc == 0;
+}
+
+/* Non-zero if the masks share any cell */
+STATIC_INLINE int mask_intersects(const BoardMask* a, const BoardMask* b) {
+    uint64_t acc = 0;
+    int i;
+    for (i = 0; i < MASK_WORDS; i++) acc |= a->w[i] & b->w[i];
+    return acc != 0;
+}
+
+/* Non-zero if every cell of inner is also set in outer */
+STATIC_INLINE int mask_covers(const BoardMask* outer, const BoardMask* inner) {
+    uint64_t acc = 0;
+    int i;
+    for (i = 0; i < MASK_WORDS; i++) acc |= inner->w[i] & ~outer->w[i];
+    return acc == 0;
+}
+
+STATIC_INLINE int mask_popcount(const BoardMask* m) {
+    int count = 0;
+    int i;
+    for (i = 0; i < MASK_WORDS; i++) count += popcount64(m->w[i]);
+    return count;
+}
+
+/* Cell of the n-th set bit (0-based) - n must be below mask_popcount */
+STATIC_INLINE int mask_select(const BoardMask* m, int n) {
+    uint64_t word;
+    int i, count;
+    for (i = 0; i < MASK_WORDS; i++) {
+        count = popcount64(m->w[i]);
+        if (n < count) {
+            word = m->w[i];
+            while (n-- > 0) word &= word - 1;
+            return i * 64 + lowest_bit(word);
+        }
+        n -= count;
+    }
+    return -1;
+}
+
+/* Function prototypes - Bitboard */
+void init_bitboards(void);
+int placement_fits(int vertical, int length, int cell);
+int placement_overlaps(const BoardMask* m, int vertical, int length, int cell);
+int placement_borders(const BoardMask* m, int vertical, int length, int cell);
+int placement_within(const BoardMask* m, int vertical, int length, int cell);
+void build_line_masks(int vertical, int length, int cell, BoardMask* ship, BoardMask* halo);
+int placement_is_legal(const Battlefield* bf, int vertical, int length, int cell);
+void mask_shift_down(const BoardMask* src, int count, BoardMask* dest);
+void mask_shift_up(const BoardMask* src, int count, BoardMask* dest);
+void clear_of_ships(const BoardMask* ships, BoardMask* free_cells);
+void free_starts(const BoardMask* free_cells, int length, BoardMask* horizontal, BoardMask* vertical);
+void legal_starts(const BoardMask* ships, int length, BoardMask* horizontal, BoardMask* vertical);
+
 /* Function prototypes - Battlefield */
 void init_battlefield(Battlefield* bf);
 void print_battlefield(Battlefield* bf, int is_wartime);
-int is_hit(Battlefield* bf, char row, int col);
-int is_miss(Battlefield* bf, char row, int col);
-void place_piece(Battlefield* bf, char row, int col, char piece);
-char get_piece(Battlefield* bf, char row, int col);
-int is_correct_coordinates(Battlefield* bf, char roF, char roS, int coF, int coS, Ship* s);
-int is_crossing(Battlefield* bf, char roF, char roS, int coF, int coS);
-int is_touching(Battlefield* bf, char roF, char roS, int coF, int coS);
+char cell_piece(const Battlefield* bf, int cell);
+int is_hit(Battlefield* bf, int row, int col);
+int is_miss(Battlefield* bf, int row, int col);
+void place_piece(Battlefield* bf, int row, int col, char piece);
+char get_piece(Battlefield* bf, int row, int col);
+int is_correct_coordinates(Battlefield* bf, int roF, int roS, int coF, int coS, Ship* s);
+int is_crossing(Battlefield* bf, int roF, int roS, int coF, int coS);
+int is_touching(Battlefield* bf, int roF, int roS, int coF, int coS);
+
+/* Function prototypes - Coordinates */
+int parse_coord(const char* text, int* cell);
+const char* coord_error_text(int code);
+int encode_coord(const char* coord);
+void decode_coord(int encoded, char* result);
+int format_row_label(int row, char* result);
 
 /* Function prototypes - Ship */
 void init_ship(Ship* s, const char* name, int length);
-void store_ship_placement(Ship* s, char roF, char roS, int coF, int coS);
-int is_part_of_ship(Ship* s, char row, int col);
-void remove_ship_part(Ship* s, char row, int col);
+void store_ship_placement(Ship* s, int roF, int roS, int coF, int coS);
+int is_part_of_ship(Ship* s, int row, int col);
+void remove_ship_part(Ship* s, int row, int col);
 int is_ship_sunken(Ship* s);
 
 /* Function prototypes - Player */
 void init_player(Player* p, const char* name);
+void reset_fleet(Player* p);
+void place_ship(Player* p, int ship_index, int roF, int roS, int coF, int coS);
+int fleet_ship_length(int index);
+int configure_board(int size, int ship_count);
 int is_navy_sunken(Player* p);
-void manage_ship_hit(Player* p, char row, int col);
+int resolve_ship_hit(Player* p, int row, int col);
 
 /* Function prototypes - AI Engine */
+typedef int (*ShipPlacer)(Player* p, int ship_index, RandomStream* rng_state);
 void init_intermediate_ai(IntermediateAI* ai);
-void ai_place_ship(Player* p, int ship_index, unsigned int* rng_state);
-void ai_fire_salvo(IntermediateAI* ai, char* result, unsigned int* rng_state);
-void ai_manage_ship_hit(Player* p, IntermediateAI* ai, char row, int col);
-int encode_coord(const char* coord);
-void decode_coord(int encoded, char* result);
+void init_advanced_ai(IntermediateAI* ai);
+void set_endgame_budget(IntermediateAI* ai, double seconds);
+void set_move_budget(IntermediateAI* ai, double seconds);
+int ai_place_ship(Player* p, int ship_index, RandomStream* rng_state);
+int ai_place_fleet(Player* p, RandomStream* rng_state);
+int place_fleet(Player* p, ShipPlacer placer, RandomStream* rng_state);
+void ai_fire_salvo(IntermediateAI* ai, char* result, RandomStream* rng_state);
+int ai_choose_salvo(IntermediateAI* ai, int count, int* cells, RandomStream* rng_state);
+int resolve_salvo(Player* p, IntermediateAI* ai, const int* cells, int count, int* results);
+int ai_resolve_ship_hit(Player* p, IntermediateAI* ai, int row, int col);
 void create_targets(IntermediateAI* ai);
-void hunt_squares(IntermediateAI* ai, char* result, unsigned int* rng_state);
-void target_ship(IntermediateAI* ai, const char* previous_shot, int is_hit, char* result);
+int select_placement_kernel(int kernel);
+const char* placement_kernel_name(void);
+void count_placements(const BoardMask* blocked, const int* fleet, int* heat);
+void hunt_squares(IntermediateAI* ai, char* result, RandomStream* rng_state);
+void target_ship(IntermediateAI* ai, int previous_shot, int is_hit, char* result, RandomStream* rng_state);
+int hunt_pick(BoardMask* targets, BoardMask* hunts, BoardMask* frontier, RandomStream* rng_state);
+
+/* Engine library - what one shot did, reported by fire_shot */
+typedef struct {
+    int cell;
+    int result;                 /* SHOT_MISS, SHOT_HIT, SHOT_SUNK or SHOT_REPEAT */
+    int ship;                   /* index of the ship hit, -1 for water */
+    int length;                 /* its length, 0 for water */
+    int game_over;              /* non-zero once the target's fleet is sunk */
+} ShotReport;
+
+/* Optional callbacks that hear a game play out - either may be NULL */
+typedef struct {
+    void (*shot)(void* context, int side, const ShotReport* report);
+    void (*game_over)(void* context, int winner);
+    void* context;
+} GameObserver;
+
+/* Two fleets in play - side 0 fires at sides[1] and side 1 at sides[0] */
+typedef struct {
+    Player* sides[2];
+    IntermediateAI* engines[2];     /* NULL for a side the client plays */
+    const GameObserver* observer;   /* NULL for none */
+    int turn;                       /* side to move */
+    int winner;                     /* -1 while the game is on */
+    int shots[2];
+} Game;
+
+/* Function prototypes - Engine library */
+int fire_shot(Player* target, IntermediateAI* shooter, int cell, ShotReport* report);
+void game_begin(Game* g, Player* side0, IntermediateAI* engine0, Player* side1, IntermediateAI* engine1,
+    int first, const GameObserver* observer);
+int game_fire(Game* g, int cell, ShotReport* report);
+int game_engine_fire(Game* g, RandomStream* rng_state, ShotReport* report);
+int game_salvo_size(const Game* g);
+int game_fire_salvo(Game* g, const int* cells, int count, ShotReport* reports);
+int game_engine_salvo(Game* g, RandomStream* rng_state, ShotReport* reports);
+
+/* Placement counting kernels - heat[cell] from blocked squares and ships per length */
+#define KERNEL_AUTO 0
+#define KERNEL_SCALAR 1
+#define KERNEL_SSE2 2
+#define KERNEL_AVX2 3
+
+typedef void (*PlacementKernel)(const BoardMask* blocked, const int* fleet, int* heat);
+
+void count_placements_scalar(const BoardMask* blocked, const int* fleet, int* heat);
+void count_placements_sse2(const BoardMask* blocked, const int* fleet, int* heat);
+void count_placements_avx2(const BoardMask* blocked, const int* fleet, int* heat);
+int cpu_has_sse2(void);
+int cpu_has_avx2(void);
+
+/* Observation kinds hashed into Zobrist keys - sunk answers add the ship's length */
+#define ZOBRIST_MISS 0
+#define ZOBRIST_HIT 1
+#define ZOBRIST_SUNK_SQUARE 2
+#define ZOBRIST_SUNK 3
+#define ZOBRIST_MODEL (ZOBRIST_SUNK + MAX_SHIP_LENGTH + 1)   /* learned model version */
+
+/* Function prototypes - Density AI */
+void init_density_state(DensityState* ds);
+void density_settle(DensityState* ds);
+void density_record_shot(DensityState* ds, int cell);
+void density_record_hit(DensityState* ds, int cell, int sunk_length);
+uint64_t zobrist_key(int token, int cell);
+uint64_t observation_key(const DensityState* ds);
+void compute_heatmap(const DensityState* ds, int* heat);
+int density_fire(DensityState* ds, char* result, RandomStream* rng_state);
+
+/* Heatmap cache counters */
+typedef struct {
+    long long slots;            /* heatmaps the cache can hold */
+    long long bytes;
+    long long lookups;
+    long long hits;
+    long long stores;
+    long long evictions;        /* settled heatmaps written over */
+} HeatCacheStats;
+
+/* Function prototypes - Heatmap cache */
+int heat_cache_init(size_t bytes);
+void heat_cache_free(void);
+int heat_cache_enabled(void);
+int heat_cache_find(uint64_t key, int* heat);
+void heat_cache_store(uint64_t key, const int* heat);
+void heat_cache_stats(HeatCacheStats* stats);
+
+/* Endgame solver - exact expectimax once few fleet configurations remain */
+#define ENDGAME_MAX_SHIPS 2         /* ships afloat at most */
+#define ENDGAME_MAX_CONFIGS 16      /* consistent configurations at most */
+#define ENDGAME_DEFAULT_BUDGET 0.01 /* seconds per move in the console game */
+
+/* Function prototypes - Endgame solver */
+int endgame_shot(const DensityState* ds, double budget);
+
+/* Consistent fleet sampler - the observations a draw must agree with */
+typedef struct {
+    BoardMask misses;           /* including a shot not yet reported as a hit */
+    BoardMask sunk;
+    BoardMask open_hits;
+    int afloat[MAX_SHIP_LENGTH + 1];  /* ships to place per length */
+    int ships;
+    int consistent;             /* non-zero if some fleet agrees with the observations */
+    int roomy;                  /* non-zero if the ships fit however they are laid - no open hits */
+    int placer;                 /* non-zero to weight fleets by their chance under ai_place_fleet */
+    int order[MAX_SHIPS];       /* ai_place_fleet's lengths for the ships afloat, in fleet order */
+    int slots;
+    int first_starts;           /* legal starts of the first slot beside the sunk ships */
+} FleetSampler;
+
+/* One drawn fleet */
+typedef struct {
+    BoardMask cells;            /* squares the fleet covers */
+    int ships;
+    int start[MAX_SHIPS];       /* start square per ship, -1 past the last */
+    int length[MAX_SHIPS];
+    int vertical[MAX_SHIPS];
+    double weight;              /* inverse of the chance of drawing this fleet, times its placer chance if asked */
+} SampledFleet;
+
+/* Function prototypes - Fleet sampler */
+void fleet_sampler_init(FleetSampler* fs, const DensityState* ds);
+int sample_fleet(const FleetSampler* fs, SampledFleet* f, RandomStream* rng_state);
+long long sample_heatmap(const FleetSampler* fs, long long samples, double deadline, int threads,
+    uint64_t seed, double* heat, long long* kept);
+
+/* Function prototypes - Monte Carlo search */
+int montecarlo_shot(const DensityState* ds, double budget, RandomStream* rng_state);
+void montecarlo_totals(long long* samples, long long* kept, double* seconds);
+
+/* Batch engine - many solo Intermediate games stored as struct-of-arrays */
+typedef struct {
+    int capacity;
+    int live;                   /* games in play, packed in slots 0 .. live - 1 */
+    int cells;                  /* squares per board, the stride of ship_at */
+    BoardMask* afloat;          /* fleet squares not yet hit */
+    BoardMask* targets;         /* squares not yet fired at */
+    BoardMask* hunts;           /* untried squares of the checkerboard */
+    BoardMask* frontier;        /* target-mode frontier around hits */
+    unsigned char* ship_at;     /* ship index per square, MAX_SHIPS for water */
+    unsigned char* ship_left;   /* squares still to hit, MAX_SHIPS + 1 per game */
+    int* previous_shot;
+    unsigned char* targeting;
+    int* shots;
+    long long* game;            /* caller's number for each game */
+    RandomStream* rng;
+    uint16_t* hunt_order;       /* checkerboard squares not yet drawn, per game */
+    int* hunt_left;             /* length of each game's hunt_order */
+    int* neighbours;            /* per square, the count and then the squares around it */
+    BoardMask* around;          /* per square, the squares around it */
+    BoardMask fresh_targets;    /* a new game's sets and shuffle list */
+    BoardMask fresh_hunts;
+    uint16_t* fresh_order;
+    int fresh_count;
+    int* shot;                  /* this step's shot per slot */
+    int* aiming;                /* this step's slots picking by the target rule */
+    int* hunting;               /* and by the hunt rule */
+    int done;                   /* games the last step finished */
+    long long* done_game;
+    int* done_shots;            /* shots taken, -1 if the game stalled */
+} GameBatch;
+
+/* Function prototypes - Batch engine */
+int batch_init(GameBatch* b, int capacity);
+void batch_free(GameBatch* b);
+int batch_add(GameBatch* b, const Player* fleet, long long game, const RandomStream* rng);
+int batch_step(GameBatch* b);
+
+/* Frame renderer - both boards and status lines, written in one go */
+#define RENDER_FULL 0
+#define RENDER_QUIET 1              /* draw nothing */
+#define RENDER_DIFF 2               /* repaint changed cells with ANSI cursor moves */
+#define BOARD_TEXT_SIZE ((MAX_BOARD_SIZE + 2) * (4 * MAX_BOARD_SIZE + 8))
+#define FRAME_BUFFER_SIZE (2 * BOARD_TEXT_SIZE + 32 * MAX_BOARD_CELLS + 1024)
+
+typedef struct {
+    const char* title;
+    const Battlefield* board;
+    int cloaked;                    /* hide ships that have not been hit */
+} RenderSide;
+
+typedef struct {
+    int mode;
+    int drawn;                      /* a full frame is on screen (diff mode) */
+    char shown[2][MAX_BOARD_CELLS]; /* pieces currently on screen (diff mode) */
+    char buffer[FRAME_BUFFER_SIZE];
+} Renderer;
+
+/* Function prototypes - Renderer */
+void init_renderer(Renderer* r, int mode);
+void renderer_invalidate(Renderer* r);
+void render_frame(Renderer* renderer, const RenderSide* left, const RenderSide* right, const char* status);
+size_t format_battlefield(const Battlefield* bf, int cloaked, char* out, size_t capacity);
+
+/* Game records - a fixed header, then one byte per shot */
+#define GAME_LOG_VERSION 2
+#define GAME_LOG_HUMAN 0xFF        /* level of a side played by a person */
+#define GAME_LOG_NO_WINNER 0xFF
+#define GAME_LOG_NO_SHOT 0x7F      /* turn spent without a shot on the board */
+#define GAME_LOG_HIT 0x80          /* shot byte - encoded square in the low 7 bits */
+#define GAME_LOG_MAX_SHOTS 1024
+#define GAME_LOG_BUFFER 65536
+
+/* Record header - bytes only, so a mapped log can be read in place */
+typedef struct {
+    uint8_t magic[4];              /* "BSGL" */
+    uint8_t version;
+    uint8_t board_size;
+    uint8_t ship_count;
+    uint8_t first;                 /* side that fired first */
+    uint8_t levels[2];             /* engine level per side, or GAME_LOG_HUMAN */
+    uint8_t winner;                /* 0, 1 or GAME_LOG_NO_WINNER */
+    uint8_t fleet_slots;           /* fleet entries per side, MAX_SHIPS of the writer */
+    uint8_t seed[8];               /* little endian */
+    uint8_t game[8];               /* game index within the run, little endian */
+    uint8_t shot_count[2];         /* little endian */
+    uint8_t reserved2[2];
+    uint8_t fleet[2][MAX_SHIPS][2];    /* start square, length | 0x80 if vertical */
+} GameRecord;
+
+/* A game being recorded - shots alternate sides, starting with header.first */
+typedef struct {
+    GameRecord header;
+    int shot_count;
+    uint8_t shots[GAME_LOG_MAX_SHOTS];
+} GameLog;
+
+/* Log file shared by worker threads */
+typedef struct {
+    FILE* file;
+    volatile long long lock;
+} GameLogSink;
+
+/* Per-thread batch of records, appended to the sink under its lock */
+typedef struct {
+    GameLogSink* sink;
+    size_t used;
+    uint8_t data[GAME_LOG_BUFFER];
+} GameLogBuffer;
+
+/* Function prototypes - Game records */
+int game_log_supported(void);
+void game_log_begin(GameLog* log, uint64_t seed, uint64_t game, int first, int level0, int level1);
+void game_log_fleet(GameLog* log, int side, const Player* p);
+void game_log_shot(GameLog* log, int cell, int is_hit);
+void game_log_observe(void* context, int side, const ShotReport* report);
+void game_log_finish(GameLog* log, int winner);
+int game_log_write(FILE* file, const GameLog* log);
+void game_log_buffer_add(GameLogBuffer* buffer, const GameLog* log);
+void game_log_buffer_flush(GameLogBuffer* buffer);
+int record_is_valid(const GameRecord* record, size_t available);
+int record_shot_count(const GameRecord* record);
+uint64_t record_u64(const uint8_t* bytes);
+void record_put_u64(uint8_t* bytes, uint64_t value);
+
+/* Placement prior - how many legal fleet layouts cover each square */
+#define PRIOR_VERSION 1
+#define PRIOR_SCALE 4096           /* weight of the most covered square */
+
+/* Prior file header, followed by BOARD_CELLS little endian 8-byte counts */
+typedef struct {
+    uint8_t magic[4];              /* "BSPR" */
+    uint8_t version;
+    uint8_t board_size;
+    uint8_t ship_count;
+    uint8_t reserved;
+    uint8_t layouts[8];            /* layouts counted, little endian */
+} PriorHeader;
+
+/* Function prototypes - Placement prior */
+int write_placement_prior(FILE* file, uint64_t layouts, const uint64_t* occupancy);
+int load_placement_prior(const char* path);
+int placement_prior_loaded(void);
+int placement_prior_pick(const BoardMask* set, RandomStream* rng_state);
+void set_placement_prior(const uint64_t* counts);
+
+/* Learned opponent model - where one opponent has put their ships */
+#define LEARNED_VERSION 1
+
+/* Model file header, followed by little endian 4-byte counts: BOARD_CELLS
+   per square, then 2 * MAX_SHIP_LENGTH * BOARD_CELLS per placement indexed
+   by orientation, length - 1 and start square */
+typedef struct {
+    uint8_t magic[4];              /* "BSLM" */
+    uint8_t version;
+    uint8_t board_size;
+    uint8_t ship_count;
+    uint8_t max_length;            /* MAX_SHIP_LENGTH of the writer */
+    uint8_t games[8];              /* games counted, little endian */
+} LearnedHeader;
+
+/* Function prototypes - Learned opponent model */
+int load_learned_prior(const char* path);
+void learned_prior_record(const Player* p);
+int save_learned_prior(const char* path);
+long long learned_prior_games(void);
+uint64_t learned_prior_version(void);
+int learned_placement_weight(int vertical, int length, int cell);
 
 /* Function prototypes - Utility */
 void clear_screen(void);
 void prompt_enter_key(void);
 void print_divider(void);
 void get_input(char* buffer, int size);
-void normalize_coordinates(char* roF, char* roS, int* coF, int* coS);
-unsigned int xorshift32(unsigned int* state);
-void init_random(unsigned int* state);
-int random_range(unsigned int* state, int min, int max);
-char random_row(unsigned int* state);
-int random_col(unsigned int* state);
+void normalize_coordinates(int* roF, int* roS, int* coF, int* coS);
+uint64_t time_seed(void);
+void random_seed(RandomStream* rng, uint64_t seed);
+void random_stream(RandomStream* rng, uint64_t seed, uint64_t index);
+void random_split(RandomStream* parent, RandomStream* child);
+void init_random(RandomStream* rng);
+int random_range(RandomStream* rng, int min, int max);
+int random_row(RandomStream* rng);
+int random_col(RandomStream* rng);
+
+/* Threading, timing and file mapping - used by the headless tools */
+typedef void (*ThreadFunc)(void* arg);
+
+typedef struct {
+    void* impl;
+} ThreadHandle;
+
+int thread_start(ThreadHandle* t, ThreadFunc fn, void* arg);
+void thread_join(ThreadHandle* t);
+int cpu_count(void);
+double monotonic_seconds(void);
+long long sync_fetch_add(volatile long long* value, long long delta);
+long long sync_compare_swap(volatile long long* value, long long expected, long long desired);
+void sync_barrier(void);
+void spin_lock(volatile long long* lock);
+void spin_unlock(volatile long long* lock);
+const void* map_file(const char* path, size_t* size);
+void unmap_file(const void* view, size_t size);
+int replace_file(const char* temp, const char* path);
+
+/* Speculative engine moves - prepared on a worker while the human types */
+#define SPECULATION_OUTCOMES 6      /* salvo sizes prepared at most */
+
+/* The engine's state after one prepared move */
+typedef struct {
+    IntermediateAI engine;
+    RandomStream rng;
+    int count;                  /* squares the move fires at */
+    int cells[MAX_SHIPS];
+} SpeculativeMove;
+
+/* A worker preparing the engine's reply to each outcome of the human's turn */
+typedef struct {
+    ThreadHandle thread;
+    int running;                    /* worker started and not yet joined */
+    volatile long long cancelled;
+    volatile long long prepared;    /* moves finished, in order */
+    IntermediateAI engine;          /* snapshot the worker thinks on */
+    RandomStream rng;
+    int salvo;                      /* salvo rules */
+    int shots;                      /* salvo size if the human sinks nothing */
+    int outcomes;
+    SpeculativeMove moves[SPECULATION_OUTCOMES];
+} Speculation;
+
+/* Function prototypes - Speculative moves */
+void speculation_start(Speculation* s, const IntermediateAI* ai, const RandomStream* rng_state,
+    int shots, int fewest);
+void speculation_cancel(Speculation* s);
+int speculation_commit(Speculation* s, IntermediateAI* ai, RandomStream* rng_state, int shots, int* cells);
+
+/*
+ * Hot-path counters - built in with -DINSTRUMENT, otherwise every STAT_ hook
+ * compiles to nothing. Each thread counts into a slot of its own with plain
+ * adds; the slots are only summed when the report is written at exit.
+ */
+#define STAT_SLOTS 256
+#define STAT_CHECK_CODES 6            /* valid, off board, misaligned, wrong length, crossing, touching */
+#define STAT_FRONTIER_BUCKETS 17      /* target frontier of 0 to 15 squares, then 16 or more */
+#define STAT_LATENCY_BUCKETS 32       /* bucket k holds moves of 2^k to 2^(k+1) - 1 ns */
+#define STAT_LATENCY_SAMPLE 16        /* one move in this many is timed - a clock read costs about as much as a move */
+
+typedef struct {
+    long long ship_placements;        /* ai_place_ship calls */
+    long long ship_no_room;           /* calls that found no legal placement */
+    long long fleet_attempts;         /* place_fleet passes - more than one per fleet is a restart */
+    long long checks[STAT_CHECK_CODES];   /* is_correct_coordinates results */
+    long long moves;                  /* ai_fire_salvo calls */
+    long long hunt_shots;
+    long long target_shots;
+    long long frontier[STAT_FRONTIER_BUCKETS];  /* target frontier size per target shot */
+    long long latency[STAT_LATENCY_BUCKETS];    /* ai_fire_salvo time of the sampled moves */
+} StatCounters;
+
+#ifdef INSTRUMENT
+    #define STAT_ADD(field, n) (stat_slot()->field += (n))
+    #define STAT_CHECK(code) stat_check(code)
+    #define STAT_FRONTIER(size) stat_frontier(size)
+#else
+    #define STAT_ADD(field, n) ((void)0)
+    #define STAT_CHECK(code) ((void)0)
+    #define STAT_FRONTIER(size) ((void)0)
+#endif
+
+/* Function prototypes - Instrumentation */
+StatCounters* stat_slot(void);
+void stat_check(int code);
+void stat_frontier(int size);
+int stat_time_move(void);
+void stat_move_latency(double seconds);
+void stat_totals(StatCounters* total);
+int stat_write_report(FILE* file, int csv);
 
 /* Platform-specific string functions */
 #ifdef _MSC_VER
@@ -0,0 +1,555 @@
+/*
+ * benchmark.c - Microbenchmarks for the Battleship engine
+ * Cross-platform: Windows (MSVC/MinGW) and UNIVAC 1219 (GCC)
+ *
+ * Every benchmark runs a seeded, repeatable workload. Each sample times a
+ * batch of operations sized to span at least SAMPLE_SECONDS; the report
+ * gives ns/op as mean, min, max and P50/P90/P99 over the samples, as JSON.
+ * Functions that print (print_battlefield, render_frame) run with stdout
+ * redirected to the null device.
+ *
+ * Usage: battleship_bench [-n SAMPLES] [-s SEED] [-o FILE] [-b NAME] [-B SIZE] [-F SHIPS]
+ *        -b runs only the benchmarks whose name contains NAME
+ *        -B and -F pick the board size and fleet in a DYNAMIC_BOARD build
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "battleship.h"
+
+#ifdef _WIN32
+    #include <io.h>
+    #define NULL_DEVICE "NUL"
+    #define DUP _dup
+    #define DUP2 _dup2
+    #define FILENO _fileno
+#else
+    #include <unistd.h>
+    #define NULL_DEVICE "/dev/null"
+    #define DUP dup
+    #define DUP2 dup2
+    #define FILENO fileno
+#endif
+
+#define BENCH_BOARDS 256
+#define BENCH_CASES 1024
+#define DEFAULT_SAMPLES 200
+#define MAX_SAMPLES 10000
+#define SAMPLE_SECONDS 0.0002
+#define MAX_BATCH (1L << 24)
+#define BENCH_BATCH_GAMES 1024
+
+/* A benchmark runs n operations per call */
+typedef void (*BenchOp)(long n);
+
+typedef struct {
+    const char* name;
+    BenchOp op;
+    int quiet;          /* redirect stdout while timing */
+} Benchmark;
+
+static uint64_t bench_seed = 1219;
+static volatile long long bench_sink;
+static double samples[MAX_SAMPLES];
+
+/* Shared fixtures, rebuilt from the seed before every benchmark */
+static BoardMask boards[BENCH_BOARDS];
+static int fleet[MAX_SHIP_LENGTH + 1];
+static char coords[MAX_BOARD_CELLS][MAX_COORD_LENGTH];
+static Player placed_players[BENCH_BOARDS];
+static IntermediateAI fresh_engine;
+static IntermediateAI fresh_advanced;
+static RandomStream rng_state;
+
+typedef struct {
+    int roF, roS;
+    int coF, coS;
+    int board;
+    int ship;
+} PlacementCase;
+
+static PlacementCase placement_cases[BENCH_CASES];
+
+/* ------------------------------------------------------------------------
+ * Fixtures
+ * ------------------------------------------------------------------------ */
+
+/* Restart the benchmark RNG from the seed so every benchmark is repeatable */
+static void reseed(void) {
+    random_seed(&rng_state, bench_seed);
+}
+
+/* Random boards with 0-60% of the squares blocked */
+static void build_fixtures(void) {
+    int b, cell, density, i, ship, vertical;
+    PlacementCase* pc;
+
+    reseed();
+    for (b = 0; b < BENCH_BOARDS; b++) {
+        mask_clear(&boards[b]);
+        density = random_range(&rng_state, 0, 60);
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            if (random_range(&rng_state, 0, 99) < density) {
+                mask_set(&boards[b], cell);
+            }
+        }
+
+        /* Fully placed fleets for the hit and game benchmarks */
+        init_player(&placed_players[b], "BENCH");
+        ai_place_fleet(&placed_players[b], &rng_state);
+    }
+
+    for (i = 0; i <= MAX_SHIP_LENGTH; i++) {
+        fleet[i] = 0;
+    }
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        fleet[fleet_ship_length(i)]++;
+    }
+
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        decode_coord(cell, coords[cell]);
+    }
+
+    /* Candidate placements of random ships against partly filled boards */
+    for (i = 0; i < BENCH_CASES; i++) {
+        pc = &placement_cases[i];
+        pc->board = random_range(&rng_state, 0, BENCH_BOARDS - 1);
+        pc->ship = random_range(&rng_state, 0, NO_OF_SHIPS - 1);
+        vertical = random_range(&rng_state, 0, 1);
+        ship = fleet_ship_length(pc->ship);
+        pc->roF = random_row(&rng_state);
+        pc->coF = random_col(&rng_state);
+        pc->roS = vertical ? pc->roF + ship - 1 : pc->roF;
+        pc->coS = vertical ? pc->coF : pc->coF + ship - 1;
+    }
+
+    init_intermediate_ai(&fresh_engine);
+    init_advanced_ai(&fresh_advanced);
+}
+
+/* ------------------------------------------------------------------------
+ * Benchmarked operations
+ * ------------------------------------------------------------------------ */
+
+static void op_encode_coord(long n) {
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        sum += encode_coord(coords[i % BOARD_CELLS]);
+    }
+    bench_sink = sum;
+}
+
+static void op_decode_coord(long n) {
+    char buffer[MAX_COORD_LENGTH];
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        decode_coord((int)(i % BOARD_CELLS), buffer);
+        sum += buffer[1];
+    }
+    bench_sink = sum;
+}
+
+static void op_is_correct_coordinates(long n) {
+    const PlacementCase* pc;
+    Player* p;
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        pc = &placement_cases[i % BENCH_CASES];
+        p = &placed_players[pc->board];
+        sum += is_correct_coordinates(&p->arena, pc->roF, pc->roS, pc->coF, pc->coS,
+            &p->ships[pc->ship]);
+    }
+    bench_sink = sum;
+}
+
+static void op_ai_place_fleet(long n) {
+    Player p;
+    long i;
+    long long sum = 0;
+    init_player(&p, "BENCH");
+    for (i = 0; i < n; i++) {
+        sum += ai_place_fleet(&p, &rng_state);
+    }
+    bench_sink = sum;
+}
+
+static void op_hunt_squares(long n) {
+    IntermediateAI ai = fresh_engine;
+    char result[MAX_COORD_LENGTH];
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        /* Refresh once the checkerboard runs out */
+        if (mask_is_empty(&ai.hunts)) {
+            ai = fresh_engine;
+        }
+        hunt_squares(&ai, result, &rng_state);
+        sum += result[0];
+    }
+    bench_sink = sum;
+}
+
+static void op_target_ship(long n) {
+    IntermediateAI ai = fresh_engine;
+    char result[MAX_COORD_LENGTH];
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        /* Refresh before the board gets sparse */
+        if (mask_popcount(&ai.targets) < BOARD_CELLS / 2) {
+            ai = fresh_engine;
+        }
+        target_ship(&ai, random_range(&rng_state, 0, BOARD_CELLS - 1), 1, result, &rng_state);
+        sum += result[0];
+    }
+    bench_sink = sum;
+}
+
+/* Hit every ship square of a fleet in turn, restoring it once sunk */
+static void op_fire_shot(long n) {
+    Player p = placed_players[0];
+    ShotReport report;
+    int cells[MAX_BOARD_CELLS];
+    int count = 0;
+    int s, k;
+    long i;
+    for (s = 0; s < NO_OF_SHIPS; s++) {
+        for (k = 0; k < p.ships[s].position_count; k++) {
+            cells[count++] = p.ships[s].cells[k];
+        }
+    }
+    for (i = 0; i < n; i++) {
+        k = (int)(i % count);
+        if (k == 0 && i > 0) {
+            p = placed_players[0];
+        }
+        fire_shot(&p, NULL, cells[k], &report);
+    }
+    bench_sink = p.ship_count;
+}
+
+/* One full game of an engine firing at a placed fleet until it is sunk */
+static int play_out(const IntermediateAI* engine, const Player* target) {
+    IntermediateAI ai = *engine;
+    Player p = *target;
+    char shot[MAX_COORD_LENGTH];
+    int shots = 0;
+    int cell;
+    int row, col;
+
+    while (!is_navy_sunken(&p) && shots < 2 * MAX_POSITIONS) {
+        ai_fire_salvo(&ai, shot, &rng_state);
+        shots++;
+        cell = ai.previous_shot;
+        row = cell_row(cell);
+        col = cell_col(cell);
+        if (is_hit(&p.arena, row, col)) {
+            ai_resolve_ship_hit(&p, &ai, row, col);
+        } else if (is_miss(&p.arena, row, col)) {
+            place_piece(&p.arena, row, col, MISS);
+        }
+    }
+    return shots;
+}
+
+static void op_game_intermediate(long n) {
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        sum += play_out(&fresh_engine, &placed_players[i % BENCH_BOARDS]);
+    }
+    bench_sink = sum;
+}
+
+static void op_game_advanced(long n) {
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        sum += play_out(&fresh_advanced, &placed_players[i % BENCH_BOARDS]);
+    }
+    bench_sink = sum;
+}
+
+/* The same games as op_game_intermediate, side by side on the batch engine */
+static void op_game_batch(long n) {
+    static GameBatch games;
+    RandomStream stream;
+    long added = 0;
+    long long sum = 0;
+    int k;
+
+    if (games.capacity == 0 && batch_init(&games, BENCH_BATCH_GAMES) != 0) {
+        return;
+    }
+    while (added < n || games.live > 0) {
+        while (added < n && games.live < games.capacity) {
+            random_stream(&stream, bench_seed, (uint64_t)added);
+            batch_add(&games, &placed_players[added % BENCH_BOARDS], added, &stream);
+            added++;
+        }
+        batch_step(&games);
+        for (k = 0; k < games.done; k++) {
+            sum += games.done_shots[k];
+        }
+    }
+    bench_sink = sum;
+}
+
+static void op_print_battlefield(long n) {
+    long i;
+    for (i = 0; i < n; i++) {
+        print_battlefield(&placed_players[i % BENCH_BOARDS].arena, (int)(i & 1));
+    }
+}
+
+static void op_render_frame(long n) {
+    static Renderer renderer;
+    RenderSide left, right;
+    long i;
+
+    init_renderer(&renderer, RENDER_FULL);
+    left.title = "ENEMY BATTLEFIELD:";
+    left.cloaked = 1;
+    right.title = "YOUR BATTLEFIELD:";
+    right.cloaked = 0;
+    for (i = 0; i < n; i++) {
+        left.board = &placed_players[i % BENCH_BOARDS].arena;
+        right.board = &placed_players[(i + 1) % BENCH_BOARDS].arena;
+        render_frame(&renderer, &left, &right, "SHIPS AFLOAT - ENEMY: 5  YOURS: 5\n");
+    }
+}
+
+/* Reference - test every placement of every length one by one */
+static void count_placements_reference(const BoardMask* blocked, const int* ships, int* heat) {
+    int length, vertical, cell, i, step;
+
+    for (i = 0; i < BOARD_CELLS; i++) {
+        heat[i] = 0;
+    }
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        if (ships[length] == 0) continue;
+        for (vertical = 0; vertical < 2; vertical++) {
+            step = vertical ? BOARD_SIZE : 1;
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                if (!placement_fits(vertical, length, cell) ||
+                    placement_overlaps(blocked, vertical, length, cell)) continue;
+                for (i = 0; i < length; i++) {
+                    heat[cell + i * step] += ships[length];
+                }
+            }
+        }
+    }
+}
+
+static void run_kernel(PlacementKernel kernel, long n) {
+    int heat[MAX_BOARD_CELLS];
+    long i;
+    long long sum = 0;
+    for (i = 0; i < n; i++) {
+        kernel(&boards[i % BENCH_BOARDS], fleet, heat);
+        sum += heat[i % BOARD_CELLS];
+    }
+    bench_sink = sum;
+}
+
+static void op_kernel_reference(long n) { run_kernel(count_placements_reference, n); }
+static void op_kernel_scalar(long n) { run_kernel(count_placements_scalar, n); }
+static void op_kernel_sse2(long n) { run_kernel(count_placements_sse2, n); }
+static void op_kernel_avx2(long n) { run_kernel(count_placements_avx2, n); }
+
+/* Check a kernel against the reference on every board */
+static int verify_kernel(PlacementKernel kernel) {
+    int expected[MAX_BOARD_CELLS], actual[MAX_BOARD_CELLS];
+    int b, i;
+
+    for (b = 0; b < BENCH_BOARDS; b++) {
+        count_placements_reference(&boards[b], fleet, expected);
+        kernel(&boards[b], fleet, actual);
+        for (i = 0; i < BOARD_CELLS; i++) {
+            if (expected[i] != actual[i]) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* JSON verdict on a kernel - null if this CPU cannot run it */
+static const char* kernel_verdict(PlacementKernel kernel, int supported) {
+    if (!supported) {
+        return "null";
+    }
+    return verify_kernel(kernel) ? "true" : "false";
+}
+
+/* ------------------------------------------------------------------------
+ * Harness
+ * ------------------------------------------------------------------------ */
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double fraction) {
+    int index = (int)(fraction * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+/* Silence stdout, returning a descriptor to restore it with */
+static int silence_stdout(void) {
+    int saved;
+    fflush(stdout);
+    saved = DUP(FILENO(stdout));
+    if (freopen(NULL_DEVICE, "w", stdout) == NULL) {
+        return -1;
+    }
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    if (saved < 0) {
+        return;
+    }
+    fflush(stdout);
+    DUP2(saved, FILENO(stdout));
+    clearerr(stdout);
+}
+
+/* Time one benchmark and append its JSON record to out */
+static void run_benchmark(FILE* out, const Benchmark* b, int sample_count, int* first) {
+    long batch = 1;
+    double started, elapsed, sum = 0.0;
+    int i, saved = -1;
+
+    reseed();
+    if (b->quiet) {
+        saved = silence_stdout();
+    }
+
+    /* Calibrate the batch so one sample spans at least SAMPLE_SECONDS */
+    while (batch < MAX_BATCH) {
+        started = monotonic_seconds();
+        b->op(batch);
+        elapsed = monotonic_seconds() - started;
+        if (elapsed >= SAMPLE_SECONDS) break;
+        batch *= 2;
+    }
+
+    reseed();
+    for (i = 0; i < sample_count; i++) {
+        started = monotonic_seconds();
+        b->op(batch);
+        samples[i] = (monotonic_seconds() - started) * 1e9 / (double)batch;
+        sum += samples[i];
+    }
+
+    restore_stdout(saved);
+    qsort(samples, (size_t)sample_count, sizeof(double), compare_doubles);
+
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"batch\": %ld, \"samples\": %d, "
+        "\"mean_ns\": %.2f, \"min_ns\": %.2f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, "
+        "\"p99_ns\": %.2f, \"max_ns\": %.2f}",
+        *first ? "" : ",", b->name, batch, sample_count,
+        sum / (double)sample_count, samples[0],
+        percentile(samples, sample_count, 0.50),
+        percentile(samples, sample_count, 0.90),
+        percentile(samples, sample_count, 0.99),
+        samples[sample_count - 1]);
+    *first = 0;
+}
+
+int main(int argc, char* argv[]) {
+    static const Benchmark benchmarks[] = {
+        { "encode_coord", op_encode_coord, 0 },
+        { "decode_coord", op_decode_coord, 0 },
+        { "is_correct_coordinates", op_is_correct_coordinates, 0 },
+        { "ai_place_fleet", op_ai_place_fleet, 0 },
+        { "hunt_squares", op_hunt_squares, 0 },
+        { "target_ship", op_target_ship, 0 },
+        { "fire_shot", op_fire_shot, 0 },
+        { "ai_fire_salvo_game_intermediate", op_game_intermediate, 0 },
+        { "ai_fire_salvo_game_advanced", op_game_advanced, 0 },
+        { "batch_game_intermediate", op_game_batch, 0 },
+        { "print_battlefield", op_print_battlefield, 1 },
+        { "render_frame", op_render_frame, 1 },
+        { "count_placements_reference", op_kernel_reference, 0 },
+        { "count_placements_scalar", op_kernel_scalar, 0 },
+        { "count_placements_sse2", op_kernel_sse2, 0 },
+        { "count_placements_avx2", op_kernel_avx2, 0 }
+    };
+    int benchmark_count = (int)(sizeof(benchmarks) / sizeof(benchmarks[0]));
+    int sample_count = DEFAULT_SAMPLES;
+    const char* filter = NULL;
+    const char* output = NULL;
+    FILE* out = stdout;
+    int board_option = BOARD_SIZE, ships_option = NO_OF_SHIPS;
+    int first = 1;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            sample_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            bench_seed = (uint64_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            board_option = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            ships_option = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "USAGE: %s [-n SAMPLES] [-s SEED] [-o FILE] [-b NAME] [-B SIZE] [-F SHIPS]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (configure_board(board_option, ships_option) != 0) {
+        fprintf(stderr, "THIS BUILD CANNOT PLAY %dX%d WITH %d SHIPS\n", board_option, board_option, ships_option);
+        return 1;
+    }
+    if (sample_count < 1) sample_count = 1;
+    if (sample_count > MAX_SAMPLES) sample_count = MAX_SAMPLES;
+
+    if (output != NULL) {
+        out = fopen(output, "w");
+        if (out == NULL) {
+            fprintf(stderr, "CANNOT OPEN %s\n", output);
+            return 1;
+        }
+    }
+
+    init_bitboards();
+    select_placement_kernel(KERNEL_AUTO);
+    build_fixtures();
+
+    fprintf(out, "{\n  \"platform\": \"%s\",\n  \"seed\": %llu,\n  \"kernel\": \"%s\",\n",
+        PLATFORM_NAME, (unsigned long long)bench_seed, placement_kernel_name());
+    fprintf(out, "  \"board_size\": %d,\n  \"ships\": %d,\n", BOARD_SIZE, NO_OF_SHIPS);
+    fprintf(out, "  \"kernels_verified\": {\"scalar\": %s, \"sse2\": %s, \"avx2\": %s},\n",
+        kernel_verdict(count_placements_scalar, 1),
+        kernel_verdict(count_placements_sse2, cpu_has_sse2()),
+        kernel_verdict(count_placements_avx2, cpu_has_avx2()));
+    fprintf(out, "  \"results\": [");
+
+    for (i = 0; i < benchmark_count; i++) {
+        if (filter != NULL && strstr(benchmarks[i].name, filter) == NULL) continue;
+        if (benchmarks[i].op == op_kernel_sse2 && !cpu_has_sse2()) continue;
+        if (benchmarks[i].op == op_kernel_avx2 && !cpu_has_avx2()) continue;
+        run_benchmark(out, &benchmarks[i], sample_count, &first);
+        fflush(out);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * bitboard.c - Placement masks for the bitboard battlefield
+ * Cross-platform compatible
+ *
+ * A ship's halo is its cells plus the squares directly left of the first
+ * and right of the last column on each covered row - exactly the
+ * neighbourhood is_touching inspects. On boards of up to
+ * PLACEMENT_TABLE_CELLS squares the cells and the rest of the halo of every
+ * placement are precomputed, so a placement test is a couple of mask
+ * intersections. Larger boards would need hundreds of megabytes of tables,
+ * so there the same tests walk the few cells of the placement instead.
+ */
+
+#include "battleship.h"
+
+#define PLACEMENT_TABLE_CELLS 1024
+
+#if MAX_BOARD_CELLS <= PLACEMENT_TABLE_CELLS
+    #define PLACEMENT_TABLES 1
+#endif
+
+#ifdef PLACEMENT_TABLES
+static BoardMask ship_table[2][MAX_SHIP_LENGTH + 1][MAX_BOARD_CELLS];
+static BoardMask ring_table[2][MAX_SHIP_LENGTH + 1][MAX_BOARD_CELLS];  /* halo minus ship */
+#endif
+static BoardMask board_mask;                          /* every square on the board */
+static BoardMask first_column, last_column;
+static BoardMask fit_horizontal[MAX_SHIP_LENGTH + 1];  /* starts that stay on the board */
+static BoardMask fit_vertical[MAX_SHIP_LENGTH + 1];
+static int tables_size = 0;                           /* board size the tables were built for */
+
+/* Build ship and halo masks for a line - both empty if it leaves the board */
+void build_line_masks(int vertical, int length, int cell, BoardMask* ship, BoardMask* halo) {
+    int row = cell / BOARD_SIZE;
+    int col = cell % BOARD_SIZE;
+    int end_row = vertical ? row + length - 1 : row;
+    int end_col = vertical ? col : col + length - 1;
+    int r, c;
+
+    mask_clear(ship);
+    mask_clear(halo);
+
+    if (cell < 0 || cell >= BOARD_CELLS || length < 1 ||
+        end_row >= BOARD_SIZE || end_col >= BOARD_SIZE) {
+        return;
+    }
+
+    for (r = row; r <= end_row; r++) {
+        for (c = col; c <= end_col; c++) {
+            mask_set(ship, r * BOARD_SIZE + c);
+            mask_set(halo, r * BOARD_SIZE + c);
+        }
+        /* Horizontal adjacency, as checked by is_touching */
+        if (col > 0) {
+            mask_set(halo, r * BOARD_SIZE + col - 1);
+        }
+        if (end_col < BOARD_SIZE - 1) {
+            mask_set(halo, r * BOARD_SIZE + end_col + 1);
+        }
+    }
+}
+
+/* Non-zero if a placement stays on the board */
+int placement_fits(int vertical, int length, int cell) {
+    if (length < 1 || cell < 0 || cell >= BOARD_CELLS) {
+        return 0;
+    }
+    if (vertical) {
+        return cell / BOARD_SIZE + length <= BOARD_SIZE;
+    }
+    return cell % BOARD_SIZE + length <= BOARD_SIZE;
+}
+
+/* Walk the cells of a placement that fits - any cell set in m */
+static int line_overlaps(const BoardMask* m, int vertical, int length, int cell) {
+    int step = vertical ? BOARD_SIZE : 1;
+    int k;
+
+    for (k = 0; k < length; k++, cell += step) {
+        if (mask_test(m, cell)) return 1;
+    }
+    return 0;
+}
+
+/* Walk the row neighbours of a placement that fits - any square set in m */
+static int line_borders(const BoardMask* m, int vertical, int length, int cell) {
+    int col = cell % BOARD_SIZE;
+    int end_col = vertical ? col : col + length - 1;
+    int rows = vertical ? length : 1;
+    int k;
+
+    for (k = 0; k < rows; k++, cell += BOARD_SIZE) {
+        if (col > 0 && mask_test(m, cell - 1)) return 1;
+        if (end_col < BOARD_SIZE - 1 && mask_test(m, cell + end_col - col + 1)) return 1;
+    }
+    return 0;
+}
+
+/* Build the placement tables for the current board size - safe to call repeatedly */
+void init_bitboards(void) {
+    int length, cell;
+    #ifdef PLACEMENT_TABLES
+    BoardMask halo;
+    int vertical, i;
+    #endif
+
+    if (tables_size == BOARD_SIZE) {
+        return;
+    }
+
+    #ifdef PLACEMENT_TABLES
+    for (vertical = 0; vertical < 2; vertical++) {
+        for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                build_line_masks(vertical, length, cell,
+                    &ship_table[vertical][length][cell], &halo);
+                for (i = 0; i < MASK_WORDS; i++) {
+                    ring_table[vertical][length][cell].w[i] =
+                        halo.w[i] & ~ship_table[vertical][length][cell].w[i];
+                }
+            }
+        }
+    }
+    #endif
+    mask_clear(&board_mask);
+    mask_clear(&first_column);
+    mask_clear(&last_column);
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        mask_set(&board_mask, cell);
+        if (cell % BOARD_SIZE == 0) mask_set(&first_column, cell);
+        if (cell % BOARD_SIZE == BOARD_SIZE - 1) mask_set(&last_column, cell);
+    }
+    for (length = 0; length <= MAX_SHIP_LENGTH; length++) {
+        mask_clear(&fit_horizontal[length]);
+        mask_clear(&fit_vertical[length]);
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            if (placement_fits(0, length, cell)) mask_set(&fit_horizontal[length], cell);
+            if (placement_fits(1, length, cell)) mask_set(&fit_vertical[length], cell);
+        }
+    }
+    tables_size = BOARD_SIZE;
+}
+
+/* Non-zero if a placement on the board covers any square set in m */
+int placement_overlaps(const BoardMask* m, int vertical, int length, int cell) {
+    if (!placement_fits(vertical, length, cell)) {
+        return 0;
+    }
+    #ifdef PLACEMENT_TABLES
+    if (length <= MAX_SHIP_LENGTH) {
+        return mask_intersects(&ship_table[vertical != 0][length][cell], m);
+    }
+    #endif
+    return line_overlaps(m, vertical, length, cell);
+}
+
+/* Non-zero if a placement on the board has a row neighbour set in m */
+int placement_borders(const BoardMask* m, int vertical, int length, int cell) {
+    if (!placement_fits(vertical, length, cell)) {
+        return 0;
+    }
+    #ifdef PLACEMENT_TABLES
+    if (length <= MAX_SHIP_LENGTH) {
+        return mask_intersects(&ring_table[vertical != 0][length][cell], m);
+    }
+    #endif
+    return line_borders(m, vertical, length, cell);
+}
+
+/* Non-zero if a placement is on the board and every square it covers is set in m */
+int placement_within(const BoardMask* m, int vertical, int length, int cell) {
+    int step = vertical ? BOARD_SIZE : 1;
+    int k;
+
+    if (!placement_fits(vertical, length, cell)) {
+        return 0;
+    }
+    #ifdef PLACEMENT_TABLES
+    if (length <= MAX_SHIP_LENGTH) {
+        return mask_covers(m, &ship_table[vertical != 0][length][cell]);
+    }
+    #endif
+    for (k = 0; k < length; k++, cell += step) {
+        if (!mask_test(m, cell)) return 0;
+    }
+    return 1;
+}
+
+/* Validate a placement against the ship mask - returns a validation code */
+int placement_is_legal(const Battlefield* bf, int vertical, int length, int cell) {
+    if (!placement_fits(vertical, length, cell)) {
+        return OUT_OF_BOARD;
+    }
+    if (placement_overlaps(&bf->ships, vertical, length, cell)) {
+        return CROSSING;
+    }
+    if (placement_borders(&bf->ships, vertical, length, cell)) {
+        return TOUCHING;
+    }
+    return VALID_COORD;
+}
+
+/* dest = src moved count squares towards cell 0 (bit i takes bit i + count) */
+void mask_shift_down(const BoardMask* src, int count, BoardMask* dest) {
+    int words = count >> 6;
+    int bits = count & 63;
+    uint64_t lo, hi;
+    int i;
+
+    for (i = 0; i < MASK_WORDS; i++) {
+        lo = i + words < MASK_WORDS ? src->w[i + words] : 0;
+        hi = i + words + 1 < MASK_WORDS ? src->w[i + words + 1] : 0;
+        dest->w[i] = bits ? (lo >> bits) | (hi << (64 - bits)) : lo;
+    }
+}
+
+/* dest = src moved count squares away from cell 0 (bit i takes bit i - count) */
+void mask_shift_up(const BoardMask* src, int count, BoardMask* dest) {
+    int words = count >> 6;
+    int bits = count & 63;
+    uint64_t lo, hi;
+    int i;
+
+    for (i = MASK_WORDS - 1; i >= 0; i--) {
+        hi = i - words >= 0 ? src->w[i - words] : 0;
+        lo = i - words - 1 >= 0 ? src->w[i - words - 1] : 0;
+        dest->w[i] = bits ? (hi << bits) | (lo >> (64 - bits)) : hi;
+    }
+    for (i = 0; i < MASK_WORDS; i++) {
+        dest->w[i] &= board_mask.w[i];
+    }
+}
+
+/* Squares a new ship may cover beside placed ships - off them and their row neighbours */
+void clear_of_ships(const BoardMask* ships, BoardMask* free_cells) {
+    BoardMask left, right;
+    int i;
+
+    mask_shift_up(ships, 1, &right);
+    mask_shift_down(ships, 1, &left);
+    for (i = 0; i < MASK_WORDS; i++) {
+        free_cells->w[i] = board_mask.w[i] & ~(ships->w[i] |
+            (right.w[i] & ~first_column.w[i]) | (left.w[i] & ~last_column.w[i]));
+    }
+}
+
+/* Start squares of every placement of a length that covers only free squares */
+void free_starts(const BoardMask* free_cells, int length, BoardMask* horizontal, BoardMask* vertical) {
+    BoardMask shifted;
+    int i, k;
+
+    if (length < 1 || length > MAX_SHIP_LENGTH) {
+        mask_clear(horizontal);
+        mask_clear(vertical);
+        return;
+    }
+
+    *horizontal = *free_cells;
+    *vertical = *free_cells;
+    for (k = 1; k < length; k++) {
+        mask_shift_down(free_cells, k, &shifted);
+        for (i = 0; i < MASK_WORDS; i++) horizontal->w[i] &= shifted.w[i];
+        mask_shift_down(free_cells, k * BOARD_SIZE, &shifted);
+        for (i = 0; i < MASK_WORDS; i++) vertical->w[i] &= shifted.w[i];
+    }
+    for (i = 0; i < MASK_WORDS; i++) {
+        horizontal->w[i] &= fit_horizontal[length].w[i];
+        vertical->w[i] &= fit_vertical[length].w[i];
+    }
+}
+
+/* Start squares of every legal horizontal and vertical placement of a length */
+void legal_starts(const BoardMask* ships, int length, BoardMask* horizontal, BoardMask* vertical) {
+    BoardMask free_cells;
+
+    /* A new ship may not cover a ship square or its row neighbours */
+    clear_of_ships(ships, &free_cells);
+    free_starts(&free_cells, length, horizontal, vertical);
+}
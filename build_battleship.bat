@@ -12,6 +12,10 @@ echo.
 set COMPILER=
 set UNIVAC_BUILD=
 
+REM Engine sources shared by the game and the headless tools
+set ENGINE_SOURCES=battlefield.c bitboard.c ship.c player.c ai_engine.c density_ai.c placement_kernel.c utils.c threads.c gamelog.c render.c coord.c prior.c instrument.c endgame.c batch.c learned.c game.c speculate.c montecarlo.c sampler.c heatcache.c
+set ENGINE_OBJECTS=battlefield.o bitboard.o ship.o player.o ai_engine.o density_ai.o placement_kernel.o utils.o threads.o gamelog.o render.o coord.o prior.o instrument.o endgame.o batch.o learned.o game.o speculate.o montecarlo.o sampler.o heatcache.o
+
 REM ============================================================================
 REM STEP 1: SELECT PLATFORM
 REM ============================================================================
@@ -73,6 +77,11 @@ echo.
 REM Clean previous build artifacts
 echo Cleaning previous build artifacts...
 if exist battleship_univac.exe del /Q battleship_univac.exe
+if exist battleship_sim_univac.exe del /Q battleship_sim_univac.exe
+if exist battleship_bench_univac.exe del /Q battleship_bench_univac.exe
+if exist battleship_enum_univac.exe del /Q battleship_enum_univac.exe
+if exist battleship_replay_univac.exe del /Q battleship_replay_univac.exe
+if exist battleship_tour_univac.exe del /Q battleship_tour_univac.exe
 if exist battleship_univac.o del /Q battleship_univac.o
 if exist *.o del /Q *.o
 echo.
@@ -85,10 +94,32 @@ echo.
 echo Compiling battleship...
 gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 main.c -o main.o
 gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 battlefield.c -o battlefield.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 bitboard.c -o bitboard.o
 gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 ship.c -o ship.o
 gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 player.c -o player.o
 gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 ai_engine.c -o ai_engine.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 density_ai.c -o density_ai.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 placement_kernel.c -o placement_kernel.o
 gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 utils.c -o utils.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 threads.c -o threads.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 gamelog.c -o gamelog.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 render.c -o render.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 coord.c -o coord.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 prior.c -o prior.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 instrument.c -o instrument.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 endgame.c -o endgame.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 batch.c -o batch.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 learned.c -o learned.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 game.c -o game.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 speculate.c -o speculate.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 montecarlo.c -o montecarlo.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 sampler.c -o sampler.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 heatcache.c -o heatcache.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 simulator.c -o simulator.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 benchmark.c -o benchmark.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 enumerate.c -o enumerate.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 replay.c -o replay.o
+gcc -c -DUNIVAC -O2 -Wall -Wextra -std=c99 tournament.c -o tournament.o
 
 if %ERRORLEVEL% NEQ 0 (
     echo ERROR: Failed to compile source files
@@ -97,7 +128,12 @@ if %ERRORLEVEL% NEQ 0 (
 )
 
 echo Linking...
-gcc -o battleship_univac.exe main.o battlefield.o ship.o player.o ai_engine.o utils.o -lm
+gcc -o battleship_univac.exe main.o %ENGINE_OBJECTS% -lm -lpthread
+gcc -o battleship_sim_univac.exe simulator.o %ENGINE_OBJECTS% -lm -lpthread
+gcc -o battleship_bench_univac.exe benchmark.o %ENGINE_OBJECTS% -lm -lpthread
+gcc -o battleship_enum_univac.exe enumerate.o %ENGINE_OBJECTS% -lm -lpthread
+gcc -o battleship_replay_univac.exe replay.o %ENGINE_OBJECTS% -lm -lpthread
+gcc -o battleship_tour_univac.exe tournament.o %ENGINE_OBJECTS% -lm -lpthread
 
 if %ERRORLEVEL% EQU 0 (
     echo.
@@ -106,6 +142,11 @@ if %ERRORLEVEL% EQU 0 (
     echo ========================================
     echo.
     echo Output: battleship_univac.exe
+    echo Simulator: battleship_sim_univac.exe
+    echo Benchmark: battleship_bench_univac.exe
+    echo Enumerator: battleship_enum_univac.exe
+    echo Replay: battleship_replay_univac.exe
+    echo Tournament: battleship_tour_univac.exe
 
     REM Display file size
     for %%A in (battleship_univac.exe) do (
@@ -158,6 +199,11 @@ echo.
 REM Clean previous build artifacts
 echo Cleaning previous build artifacts...
 if exist battleship_mingw.exe del /Q battleship_mingw.exe
+if exist battleship_sim_mingw.exe del /Q battleship_sim_mingw.exe
+if exist battleship_bench_mingw.exe del /Q battleship_bench_mingw.exe
+if exist battleship_enum_mingw.exe del /Q battleship_enum_mingw.exe
+if exist battleship_replay_mingw.exe del /Q battleship_replay_mingw.exe
+if exist battleship_tour_mingw.exe del /Q battleship_tour_mingw.exe
 if exist battleship.obj del /Q battleship.obj
 if exist *.o del /Q *.o
 echo.
@@ -199,7 +245,32 @@ echo.
 echo Compiling and linking...
 gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
     -o battleship_mingw.exe ^
-    main.c battlefield.c ship.c player.c ai_engine.c utils.c ^
+    main.c %ENGINE_SOURCES% ^
+    %LINKER_FLAGS% -lm
+
+gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
+    -o battleship_sim_mingw.exe ^
+    simulator.c %ENGINE_SOURCES% ^
+    %LINKER_FLAGS% -lm
+
+gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
+    -o battleship_bench_mingw.exe ^
+    benchmark.c %ENGINE_SOURCES% ^
+    %LINKER_FLAGS% -lm
+
+gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
+    -o battleship_enum_mingw.exe ^
+    enumerate.c %ENGINE_SOURCES% ^
+    %LINKER_FLAGS% -lm
+
+gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
+    -o battleship_replay_mingw.exe ^
+    replay.c %ENGINE_SOURCES% ^
+    %LINKER_FLAGS% -lm
+
+gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
+    -o battleship_tour_mingw.exe ^
+    tournament.c %ENGINE_SOURCES% ^
     %LINKER_FLAGS% -lm
 
 if %ERRORLEVEL% EQU 0 (
@@ -209,6 +280,11 @@ if %ERRORLEVEL% EQU 0 (
     echo ========================================
     echo.
     echo Output: battleship_mingw.exe
+    echo Simulator: battleship_sim_mingw.exe
+    echo Benchmark: battleship_bench_mingw.exe
+    echo Enumerator: battleship_enum_mingw.exe
+    echo Replay: battleship_replay_mingw.exe
+    echo Tournament: battleship_tour_mingw.exe
 
     REM Display file size
     for %%A in (battleship_mingw.exe) do (
@@ -228,6 +304,11 @@ if %ERRORLEVEL% EQU 0 (
     echo ========================================
     echo.
     echo Output: battleship_mingw.exe
+    echo Simulator: battleship_sim_mingw.exe
+    echo Benchmark: battleship_bench_mingw.exe
+    echo Enumerator: battleship_enum_mingw.exe
+    echo Replay: battleship_replay_mingw.exe
+    echo Tournament: battleship_tour_mingw.exe
 
     REM Display file size
     for %%A in (battleship_mingw.exe) do (
@@ -291,7 +372,12 @@ set MSVC_OPTIMIZE=/O2 /Ox /Ob2 /Oi /Ot /Oy /GL /arch:AVX2
 set MSVC_LINKER=/LTCG /OPT:REF /OPT:ICF
 
 REM Compile source file with maximum optimizations
-cl /W4 %MSVC_OPTIMIZE% /Fe:battleship.exe main.c battlefield.c ship.c player.c ai_engine.c utils.c /link %MSVC_LINKER%
+cl /W4 %MSVC_OPTIMIZE% /Fe:battleship.exe main.c %ENGINE_SOURCES% /link %MSVC_LINKER%
+if %ERRORLEVEL% EQU 0 cl /W4 %MSVC_OPTIMIZE% /Fe:battleship_sim.exe simulator.c %ENGINE_SOURCES% /link %MSVC_LINKER%
+if %ERRORLEVEL% EQU 0 cl /W4 %MSVC_OPTIMIZE% /Fe:battleship_bench.exe benchmark.c %ENGINE_SOURCES% /link %MSVC_LINKER%
+if %ERRORLEVEL% EQU 0 cl /W4 %MSVC_OPTIMIZE% /Fe:battleship_enum.exe enumerate.c %ENGINE_SOURCES% /link %MSVC_LINKER%
+if %ERRORLEVEL% EQU 0 cl /W4 %MSVC_OPTIMIZE% /Fe:battleship_replay.exe replay.c %ENGINE_SOURCES% /link %MSVC_LINKER%
+if %ERRORLEVEL% EQU 0 cl /W4 %MSVC_OPTIMIZE% /Fe:battleship_tour.exe tournament.c %ENGINE_SOURCES% /link %MSVC_LINKER%
 
 if %ERRORLEVEL% EQU 0 (
     echo.
@@ -300,6 +386,11 @@ if %ERRORLEVEL% EQU 0 (
     echo ========================================
     echo.
     echo Output: battleship.exe
+    echo Simulator: battleship_sim.exe
+    echo Benchmark: battleship_bench.exe
+    echo Enumerator: battleship_enum.exe
+    echo Replay: battleship_replay.exe
+    echo Tournament: battleship_tour.exe
 
     REM Display file size
     for %%A in (battleship.exe) do (
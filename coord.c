@@ -0,0 +1,124 @@
+/*
+ * coord.c - Coordinate parsing and formatting
+ * Cross-platform compatible
+ *
+ * A coordinate is a row label (A to Z, then AA, AB, ...) followed by a
+ * 1-based column number, e.g. "J10" or "b5". parse_coord reads one in a
+ * single pass without sscanf or allocation and reports what is wrong with
+ * it by code; decode_coord writes one from small constant tables instead
+ * of a formatted print. The console game, the engines and the tools all go
+ * through these two functions.
+ */
+
+#include "battleship.h"
+
+/* Two-digit strings "00" to "99", two characters per entry */
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Upper-case letter of a character, or -1 if it is not a letter */
+static int letter_index(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    return -1;
+}
+
+/* Parse a coordinate into an encoded square - returns VALID_COORD or an error code */
+int parse_coord(const char* text, int* cell) {
+    int row = -1;
+    int column = 0;
+    int letter, digits = 0;
+
+    while (*text == ' ' || *text == '\t') text++;
+
+    /* Row label in bijective base 26 - Z is followed by AA */
+    while ((letter = letter_index(*text)) >= 0) {
+        if (row < BOARD_SIZE) {
+            row = (row + 1) * 26 + letter;
+        }
+        text++;
+    }
+    if (row < 0) {
+        return NO_ROW;
+    }
+
+    while (*text >= '0' && *text <= '9') {
+        if (column <= BOARD_SIZE) {
+            column = column * 10 + (*text - '0');
+        }
+        digits++;
+        text++;
+    }
+    if (digits == 0) {
+        return NO_COLUMN;
+    }
+
+    while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') text++;
+    if (*text != '\0') {
+        return EXTRA_TEXT;
+    }
+
+    if (row >= BOARD_SIZE || column < 1 || column > BOARD_SIZE) {
+        return OUT_OF_BOARD;
+    }
+    *cell = row * BOARD_SIZE + column - 1;
+    return VALID_COORD;
+}
+
+/* Message for a parse_coord error code */
+const char* coord_error_text(int code) {
+    switch (code) {
+        case NO_ROW: return "A COORDINATE STARTS WITH A ROW LETTER";
+        case NO_COLUMN: return "THE ROW LETTER MUST BE FOLLOWED BY A COLUMN NUMBER";
+        case EXTRA_TEXT: return "UNEXPECTED TEXT AFTER THE COORDINATE";
+        case OUT_OF_BOARD: return "THAT SQUARE IS NOT ON THE BOARD";
+        default: return "VALID COORDINATE";
+    }
+}
+
+/* Encode string coordinates to integer (A1 = 0, J10 = 99 on a 10x10 board) - -1 if invalid */
+int encode_coord(const char* coord) {
+    int cell;
+    return parse_coord(coord, &cell) == VALID_COORD ? cell : -1;
+}
+
+/* Write the label of a 0-based row - A to Z, then AA, AB, ... - returns its length */
+int format_row_label(int row, char* result) {
+    char letters[8];
+    int n = 0, k;
+
+    do {
+        letters[n++] = (char)('A' + row % 26);
+        row = row / 26 - 1;
+    } while (row >= 0 && n < (int)sizeof(letters));
+    for (k = 0; k < n; k++) {
+        result[k] = letters[n - 1 - k];
+    }
+    result[n] = '\0';
+    return n;
+}
+
+/* Decode integer to string coordinates */
+void decode_coord(int encoded, char* result) {
+    int row = encoded / BOARD_SIZE;
+    int column = encoded % BOARD_SIZE + 1;
+    char* out = result;
+
+    /* One or two letter rows cover every board up to 702 rows */
+    if (row >= 26) {
+        *out++ = (char)('A' + row / 26 - 1);
+    }
+    *out++ = (char)('A' + row % 26);
+
+    if (column >= 100) {
+        *out++ = (char)('0' + column / 100);
+        column %= 100;
+        *out++ = digit_pairs[2 * column];
+    } else if (column >= 10) {
+        *out++ = digit_pairs[2 * column];
+    }
+    *out++ = digit_pairs[2 * column + 1];
+    *out = '\0';
+}
@@ -0,0 +1,277 @@
+/*
+ * density_ai.c - Advanced Adversary AI Engine for Battleship
+ * Cross-platform compatible
+ * Implements probability-density targeting
+ *
+ * Every turn the engine counts, for each square, how many legal placements
+ * of the ships still afloat would cover it given what it has observed, and
+ * fires at the square with the highest count. Placements that explain
+ * unresolved hits are weighted heavily so the engine finishes wounded ships
+ * before hunting again. With a learned opponent model loaded, every
+ * placement, hunting or targeting, is weighted further by how often the
+ * opponent has been seen to use it. Games that reach the same observations can share
+ * the counted heatmap through the cache in heatcache.c.
+ */
+
+#include "battleship.h"
+
+/* Weight of a placement per unresolved hit it covers */
+#define TARGET_WEIGHT 1024
+
+/* Initialize the observed state for a fresh standard fleet */
+void init_density_state(DensityState* ds) {
+    int i;
+
+    mask_clear(&ds->fired);
+    mask_clear(&ds->misses);
+    mask_clear(&ds->open_hits);
+    mask_clear(&ds->sunk);
+
+    for (i = 0; i <= MAX_SHIP_LENGTH; i++) {
+        ds->afloat[i] = 0;
+    }
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        ds->afloat[fleet_ship_length(i)]++;
+    }
+    ds->pending_cell = -1;
+}
+
+/* The previous shot was a miss unless a hit was reported for it */
+void density_settle(DensityState* ds) {
+    if (ds->pending_cell >= 0) {
+        mask_set(&ds->misses, ds->pending_cell);
+        ds->pending_cell = -1;
+    }
+}
+
+/* Record a shot at cell - a miss unless a hit is reported for it */
+void density_record_shot(DensityState* ds, int cell) {
+    density_settle(ds);
+    mask_set(&ds->fired, cell);
+    ds->pending_cell = cell;
+}
+
+/* Attribute a sunk ship to a line of open hits running through cell */
+static void mark_sunk(DensityState* ds, int cell, int length) {
+    int row = cell / BOARD_SIZE;
+    int col = cell % BOARD_SIZE;
+    int found = 0;
+    int vertical, k, i, first, step;
+
+    for (vertical = 0; vertical < 2 && !found; vertical++) {
+        for (k = 0; k < length && !found; k++) {
+            /* Start square that puts cell at offset k along the ship */
+            if (vertical) {
+                if (row - k < 0) break;
+                first = cell - k * BOARD_SIZE;
+            } else {
+                if (col - k < 0) break;
+                first = cell - k;
+            }
+
+            if (placement_within(&ds->open_hits, vertical, length, first)) {
+                found = 1;
+                step = vertical ? BOARD_SIZE : 1;
+                for (i = 0; i < length; i++, first += step) {
+                    mask_reset(&ds->open_hits, first);
+                    mask_set(&ds->sunk, first);
+                }
+            }
+        }
+    }
+
+    if (!found) {
+        /* Inconsistent report - retire at least the sinking square */
+        mask_reset(&ds->open_hits, cell);
+        mask_set(&ds->sunk, cell);
+    }
+
+    if (length >= 1 && length <= MAX_SHIP_LENGTH && ds->afloat[length] > 0) {
+        ds->afloat[length]--;
+    }
+}
+
+/* Record a hit on cell - sunk_length is the sunk ship's length, 0 if afloat */
+void density_record_hit(DensityState* ds, int cell, int sunk_length) {
+    if (ds->pending_cell == cell) {
+        ds->pending_cell = -1;
+    }
+    density_settle(ds);
+
+    mask_set(&ds->fired, cell);
+    mask_set(&ds->open_hits, cell);
+
+    if (sunk_length > 0) {
+        mark_sunk(ds, cell, sunk_length);
+    }
+}
+
+/* Zobrist key of an observation on a square - one SplitMix64 step from both */
+uint64_t zobrist_key(int token, int cell) {
+    uint64_t z = ((uint64_t)token << 32 | (uint64_t)cell) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Mix the key of every square of m under one observation kind */
+static uint64_t mask_key(const BoardMask* m, int token) {
+    uint64_t key = 0;
+    uint64_t word;
+    int i;
+
+    for (i = 0; i < MASK_WORDS; i++) {
+        for (word = m->w[i]; word != 0; word &= word - 1) {
+            key ^= zobrist_key(token, i * 64 + lowest_bit(word));
+        }
+    }
+    return key;
+}
+
+/* Hash of every settled observation and of the ships still afloat */
+uint64_t observation_key(const DensityState* ds) {
+    uint64_t key = 0;
+    int length;
+
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        key ^= zobrist_key(ZOBRIST_SUNK + length, BOARD_CELLS + ds->afloat[length]);
+    }
+    return key ^ mask_key(&ds->misses, ZOBRIST_MISS) ^ mask_key(&ds->open_hits, ZOBRIST_HIT) ^
+        mask_key(&ds->sunk, ZOBRIST_SUNK_SQUARE);
+}
+
+/* Blocked squares while hunting - misses, sunk ships and their row neighbours */
+static void hunting_blocked(const DensityState* ds, BoardMask* blocked) {
+    uint64_t word;
+    int i, cell;
+
+    for (i = 0; i < MASK_WORDS; i++) {
+        blocked->w[i] = ds->misses.w[i];
+    }
+    for (i = 0; i < MASK_WORDS; i++) {
+        word = ds->sunk.w[i];
+        while (word != 0) {
+            cell = i * 64 + lowest_bit(word);
+            word &= word - 1;
+            /* The square and its row neighbours */
+            mask_set(blocked, cell);
+            if (cell % BOARD_SIZE > 0) mask_set(blocked, cell - 1);
+            if (cell % BOARD_SIZE < BOARD_SIZE - 1) mask_set(blocked, cell + 1);
+        }
+    }
+}
+
+/* Count consistent placements of every afloat ship over each square */
+static void count_heatmap(const DensityState* ds, int* heat) {
+    BoardMask body_blocked, ring_blocked;
+    int length, vertical, cell, step, i, c, covered, weight;
+
+    /* With no wounded ship to explain and no learned weights, the placement kernel does the counting */
+    if (mask_is_empty(&ds->open_hits) && learned_prior_games() == 0) {
+        hunting_blocked(ds, &body_blocked);
+        count_placements(&body_blocked, ds->afloat, heat);
+        return;
+    }
+
+    for (i = 0; i < BOARD_CELLS; i++) {
+        heat[i] = 0;
+    }
+
+    /* Ships cannot lie on misses or sunk ships, nor touch other ships */
+    for (i = 0; i < MASK_WORDS; i++) {
+        body_blocked.w[i] = ds->misses.w[i] | ds->sunk.w[i];
+        ring_blocked.w[i] = ds->open_hits.w[i] | ds->sunk.w[i];
+    }
+
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        if (ds->afloat[length] == 0) continue;
+
+        for (vertical = 0; vertical < 2; vertical++) {
+            step = vertical ? BOARD_SIZE : 1;
+
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                if (!placement_fits(vertical, length, cell) ||
+                    placement_overlaps(&body_blocked, vertical, length, cell) ||
+                    placement_borders(&ring_blocked, vertical, length, cell)) {
+                    continue;
+                }
+
+                covered = 0;
+                for (i = 0, c = cell; i < length; i++, c += step) {
+                    covered += mask_test(&ds->open_hits, c);
+                }
+                weight = ds->afloat[length] * (covered ? TARGET_WEIGHT * covered : 1) *
+                    learned_placement_weight(vertical, length, cell);
+
+                for (i = 0, c = cell; i < length; i++, c += step) {
+                    if (!mask_test(&ds->fired, c)) {
+                        heat[c] += weight;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Heatmap of the observations - from the shared cache when it holds them */
+void compute_heatmap(const DensityState* ds, int* heat) {
+    uint64_t key;
+
+    if (!heat_cache_enabled()) {
+        count_heatmap(ds, heat);
+        return;
+    }
+
+    /* A learned model's weights change after every game, so each version keys its own heatmaps */
+    key = observation_key(ds);
+    if (learned_prior_games() > 0) {
+        key ^= zobrist_key(ZOBRIST_MODEL, (int)(learned_prior_version() & 0x7FFFFFFF));
+    }
+    if (!heat_cache_find(key, heat)) {
+        count_heatmap(ds, heat);
+        heat_cache_store(key, heat);
+    }
+}
+
+/* Fire at the hottest unfired square, ties broken at random - returns the square */
+int density_fire(DensityState* ds, char* result, RandomStream* rng_state) {
+    int heat[MAX_BOARD_CELLS];
+    int best = -1;
+    int best_heat = -1;
+    int ties = 0;
+    int cell;
+
+    density_settle(ds);
+    compute_heatmap(ds, heat);
+    if (mask_is_empty(&ds->open_hits)) {
+        STAT_ADD(hunt_shots, 1);
+    } else {
+        STAT_ADD(target_shots, 1);
+    }
+
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        if (mask_test(&ds->fired, cell)) continue;
+
+        if (heat[cell] > best_heat) {
+            best = cell;
+            best_heat = heat[cell];
+            ties = 1;
+        } else if (heat[cell] == best_heat) {
+            /* Reservoir sampling keeps the choice uniform among ties */
+            ties++;
+            if (random_range(rng_state, 0, ties - 1) == 0) {
+                best = cell;
+            }
+        }
+    }
+
+    if (best < 0) {
+        /* No squares left - shouldn't happen in normal game */
+        SAFE_STRCPY(result, "A1", MAX_COORD_LENGTH);
+        return 0;
+    }
+
+    density_record_shot(ds, best);
+    decode_coord(best, result);
+    return best;
+}
@@ -0,0 +1,383 @@
+/*
+ * endgame.c - Exact endgame solver
+ * Cross-platform compatible
+ *
+ * Once at most ENDGAME_MAX_SHIPS ships are afloat, the engine lists every
+ * placement of them that agrees with what it has seen: no ship on a miss or
+ * a sunk ship, none touching another ship along a row, every open hit
+ * covered and every ship with a square still to hit. If there are at most
+ * ENDGAME_MAX_CONFIGS such configurations, all equally likely, it picks the
+ * shot that minimises the expected number of shots left, by expectimax over
+ * the answers each shot can get: miss, hit, or sunk with the ship's length.
+ *
+ * A set of configurations is identified by the observations that led to it,
+ * so values are memoised under a Zobrist hash of the misses, hits and sunk
+ * ships. The keys are mixed on the fly from square and observation, and the
+ * table is per thread and kept across games, so the many games that reach
+ * the same endgame position share the work. The search stops at the move's
+ * time budget and then plays the best shot it finished, or failing that the
+ * square most configurations cover.
+ */
+
+#include "battleship.h"
+
+#define ENDGAME_MAX_CELLS (ENDGAME_MAX_SHIPS * MAX_SHIP_LENGTH)
+#define ENDGAME_MAX_CANDIDATES 128   /* shots tried per position, most covered first */
+#define ENDGAME_TABLE_SIZE 8192      /* transposition entries per thread, a power of two */
+#define ENDGAME_CLOCK_NODES 64       /* positions searched between clock reads */
+
+/* Answers a shot can get - miss, hit, or sunk with each length */
+#define ENDGAME_ANSWERS (ZOBRIST_SUNK + MAX_SHIP_LENGTH + 1)
+
+/* One placement of the ships afloat - cells of ship k are bits ship_bits[k] */
+typedef struct {
+    int cells[ENDGAME_MAX_CELLS];
+    int cell_count;
+    int ship_count;
+    unsigned ship_bits[ENDGAME_MAX_SHIPS];
+    int ship_length[ENDGAME_MAX_SHIPS];
+} EndgameConfig;
+
+/* A configuration still possible in a position, with the bits of its cells hit so far */
+typedef struct {
+    uint16_t config;
+    uint16_t hit;
+} EndgameItem;
+
+typedef struct {
+    uint64_t key;
+    double value;           /* the exact value, or a lower bound */
+    int16_t shot;
+    int8_t exact;
+} EndgameEntry;
+
+/* Search state of the move in hand */
+typedef struct {
+    EndgameConfig configs[ENDGAME_MAX_CONFIGS];
+    int config_count;
+    int coverage[MAX_BOARD_CELLS];
+    int lengths[ENDGAME_MAX_SHIPS];
+    int ship_count;
+    double deadline;
+    long long nodes;
+    int timed_out;
+} EndgameSearch;
+
+static THREAD_LOCAL EndgameSearch search;
+static THREAD_LOCAL EndgameEntry table[ENDGAME_TABLE_SIZE];
+static THREAD_LOCAL int table_size = 0;          /* board size the table was filled for */
+
+/* Place ships depth on, recording every configuration that explains all open hits - -1 if there are too many */
+static int list_configs(const DensityState* ds, const BoardMask* placed, int depth,
+    EndgameConfig* partial, int min_key) {
+    BoardMask body, ring, next;
+    int length = search.lengths[depth];
+    int vertical, cell, key, step, k, i, unhit;
+
+    if (depth == search.ship_count) {
+        if (!mask_covers(placed, &ds->open_hits)) {
+            return 0;
+        }
+        if (search.config_count >= ENDGAME_MAX_CONFIGS) {
+            return -1;
+        }
+        search.configs[search.config_count++] = *partial;
+        return 0;
+    }
+
+    for (i = 0; i < MASK_WORDS; i++) {
+        body.w[i] = ds->misses.w[i] | ds->sunk.w[i] | placed->w[i];
+        ring.w[i] = ds->open_hits.w[i] | ds->sunk.w[i] | placed->w[i];
+    }
+
+    for (vertical = 0; vertical < 2; vertical++) {
+        step = vertical ? BOARD_SIZE : 1;
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            /* Equal ships are placed in one order only */
+            key = vertical * BOARD_CELLS + cell;
+            if (key <= min_key && depth > 0 && length == search.lengths[depth - 1]) continue;
+            if (!placement_fits(vertical, length, cell) ||
+                placement_overlaps(&body, vertical, length, cell) ||
+                placement_borders(&ring, vertical, length, cell)) {
+                continue;
+            }
+
+            /* A ship with every square hit would have been reported sunk */
+            unhit = 0;
+            for (k = 0; k < length; k++) {
+                unhit += !mask_test(&ds->open_hits, cell + k * step);
+            }
+            if (unhit == 0) continue;
+
+            next = *placed;
+            partial->ship_bits[depth] = 0;
+            partial->ship_length[depth] = length;
+            for (k = 0; k < length; k++) {
+                mask_set(&next, cell + k * step);
+                partial->ship_bits[depth] |= 1u << partial->cell_count;
+                partial->cells[partial->cell_count++] = cell + k * step;
+            }
+            if (list_configs(ds, &next, depth + 1, partial, key) != 0) {
+                return -1;
+            }
+            partial->cell_count -= length;
+        }
+    }
+    return 0;
+}
+
+/* Bits of a configuration's cells that are open hits */
+static unsigned initial_hits(const DensityState* ds, const EndgameConfig* c) {
+    unsigned hit = 0;
+    int k;
+
+    for (k = 0; k < c->cell_count; k++) {
+        if (mask_test(&ds->open_hits, c->cells[k])) hit |= 1u << k;
+    }
+    return hit;
+}
+
+/* Squares of a configuration still to hit */
+static int unhit_count(const EndgameItem* item) {
+    const EndgameConfig* c = &search.configs[item->config];
+    return c->cell_count - popcount64(item->hit);
+}
+
+/* Answer a configuration gives to a shot - ZOBRIST_MISS, ZOBRIST_HIT or ZOBRIST_SUNK + length; *hit gets the new bits */
+static int answer(const EndgameItem* item, int shot, unsigned* hit) {
+    const EndgameConfig* c = &search.configs[item->config];
+    int k, s;
+
+    *hit = item->hit;
+    for (k = 0; k < c->cell_count; k++) {
+        if (c->cells[k] == shot) break;
+    }
+    if (k == c->cell_count) {
+        return ZOBRIST_MISS;
+    }
+    *hit |= 1u << k;
+    for (s = 0; s < c->ship_count; s++) {
+        if ((c->ship_bits[s] >> k) & 1) {
+            return (*hit & c->ship_bits[s]) == c->ship_bits[s] ? ZOBRIST_SUNK + c->ship_length[s] : ZOBRIST_HIT;
+        }
+    }
+    return ZOBRIST_HIT;
+}
+
+/* Unfired squares the configurations cover, most covered first - returns how many */
+static int list_candidates(const EndgameItem* items, int n, int* shots, int* counts) {
+    const EndgameConfig* c;
+    int count = 0;
+    int i, k, j, cell, shot, covered;
+
+    for (i = 0; i < n; i++) {
+        c = &search.configs[items[i].config];
+        for (k = 0; k < c->cell_count; k++) {
+            if ((items[i].hit >> k) & 1) continue;
+            cell = c->cells[k];
+            if (search.coverage[cell]++ == 0 && count < ENDGAME_MAX_CANDIDATES) {
+                shots[count++] = cell;
+            }
+        }
+    }
+
+    /* Insertion sort by coverage, resetting the counts on the way */
+    for (i = 0; i < count; i++) {
+        shot = shots[i];
+        covered = search.coverage[shot];
+        for (j = i; j > 0 && counts[j - 1] < covered; j--) {
+            shots[j] = shots[j - 1];
+            counts[j] = counts[j - 1];
+        }
+        shots[j] = shot;
+        counts[j] = covered;
+    }
+    for (i = 0; i < n; i++) {
+        c = &search.configs[items[i].config];
+        for (k = 0; k < c->cell_count; k++) {
+            search.coverage[c->cells[k]] = 0;
+        }
+    }
+    return count;
+}
+
+/* Most configurations of an answer's bucket that still need one square - hits given by hits[] */
+static int bucket_coverage(const EndgameItem* items, int n, const uint8_t* answers,
+    const uint16_t* hits, int bucket) {
+    const EndgameConfig* c;
+    int most = 0;
+    int j, k, pass;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (j = 0; j < n; j++) {
+            if (answers[j] != bucket) continue;
+            c = &search.configs[items[j].config];
+            for (k = 0; k < c->cell_count; k++) {
+                if ((hits[j] >> k) & 1) continue;
+                if (pass == 0) {
+                    if (++search.coverage[c->cells[k]] > most) most = search.coverage[c->cells[k]];
+                } else {
+                    search.coverage[c->cells[k]] = 0;
+                }
+            }
+        }
+    }
+    return most;
+}
+
+/* Expected shots to sink every ship left, playing best - *best_shot gets the shot. A value
+   of at least beta only needs to be shown to be so; *exact is then 0 and so is *best_shot -1 */
+static double solve(const EndgameItem* items, int n, uint64_t key, double beta, int* best_shot, int* exact) {
+    EndgameItem child[ENDGAME_MAX_CONFIGS];
+    int shots[ENDGAME_MAX_CANDIDATES];
+    int counts[ENDGAME_MAX_CANDIDATES];
+    uint8_t answers[ENDGAME_MAX_CONFIGS];
+    uint16_t hits[ENDGAME_MAX_CONFIGS];
+    int bucket_size[ENDGAME_ANSWERS];
+    double bucket_bound[ENDGAME_ANSWERS];
+    EndgameEntry* entry = &table[key & (ENDGAME_TABLE_SIZE - 1)];
+    double best = beta, total, value;
+    int candidate_count, i, j, t, size, shot, dummy, child_exact;
+    unsigned hit, all;
+
+    *best_shot = -1;
+    *exact = 1;
+    if (entry->key == key && (entry->exact || entry->value >= beta)) {
+        *best_shot = entry->shot;
+        *exact = entry->exact;
+        return entry->value;
+    }
+    if (++search.nodes % ENDGAME_CLOCK_NODES == 0 && monotonic_seconds() > search.deadline) {
+        search.timed_out = 1;
+    }
+    if (search.timed_out) {
+        return 0.0;
+    }
+
+    /* Every shot either misses some configurations or hits a square they all need */
+    candidate_count = list_candidates(items, n, shots, counts);
+    for (j = 0, total = 0.0; j < n; j++) {
+        total += unhit_count(&items[j]);
+    }
+    total = (total + n - counts[0]) / n;
+    if (total >= beta) {
+        *exact = 0;
+        return total;
+    }
+    if (n == 1 || counts[0] == n) {
+        /* A square every configuration still needs must be shot some time, so shoot it now */
+        candidate_count = 1;
+    }
+
+    for (i = 0; i < candidate_count; i++) {
+        shot = shots[i];
+        for (t = 0; t < ENDGAME_ANSWERS; t++) {
+            bucket_size[t] = 0;
+            bucket_bound[t] = 0.0;
+        }
+
+        /* Split by answer - each configuration still needs its squares left... */
+        total = 1.0;
+        for (j = 0; j < n; j++) {
+            answers[j] = (uint8_t)answer(&items[j], shot, &hit);
+            hits[j] = (uint16_t)hit;
+            all = (1u << search.configs[items[j].config].cell_count) - 1;
+            if (hit != all) {
+                bucket_size[answers[j]]++;
+                bucket_bound[answers[j]] += popcount64(all & ~hit);
+            }
+        }
+        for (t = 0; t < ENDGAME_ANSWERS; t++) {
+            if (bucket_size[t] > 1) {
+                /* ...and the next shot misses all but the most it can hit */
+                bucket_bound[t] += bucket_size[t] - bucket_coverage(items, n, answers, hits, t);
+            }
+            total += bucket_bound[t] / n;
+        }
+
+        /* Replace each bound by the bucket's value while the shot can still beat the best */
+        for (t = 0; t < ENDGAME_ANSWERS && total < best; t++) {
+            if (bucket_size[t] < 2) continue;
+            size = 0;
+            for (j = 0; j < n; j++) {
+                all = (1u << search.configs[items[j].config].cell_count) - 1;
+                if (answers[j] == t && hits[j] != all) {
+                    child[size].config = items[j].config;
+                    child[size].hit = hits[j];
+                    size++;
+                }
+            }
+            value = solve(child, size, key ^ zobrist_key(t, shot),
+                ((best - total) * n + bucket_bound[t]) / size, &dummy, &child_exact);
+            if (search.timed_out) {
+                return 0.0;
+            }
+            total += (value * size - bucket_bound[t]) / n;
+            if (!child_exact) {
+                total = best;
+            }
+        }
+        if (total < best) {
+            best = total;
+            *best_shot = shot;
+        }
+    }
+
+    *exact = *best_shot >= 0;
+    entry->key = key;
+    entry->value = best;
+    entry->shot = (int16_t)*best_shot;
+    entry->exact = (int8_t)*exact;
+    return best;
+}
+
+/* Best shot once few configurations remain - -1 if the position is not an endgame or time ran out */
+int endgame_shot(const DensityState* ds, double budget) {
+    EndgameConfig partial;
+    EndgameItem items[ENDGAME_MAX_CONFIGS];
+    BoardMask placed;
+    int shots[ENDGAME_MAX_CANDIDATES];
+    int counts[ENDGAME_MAX_CANDIDATES];
+    int length, k, best_shot, exact;
+
+    search.deadline = monotonic_seconds() + budget;
+    search.ship_count = 0;
+    for (length = MAX_SHIP_LENGTH; length >= 1; length--) {
+        for (k = 0; k < ds->afloat[length]; k++) {
+            if (search.ship_count == ENDGAME_MAX_SHIPS) {
+                return -1;
+            }
+            search.lengths[search.ship_count++] = length;
+        }
+    }
+    if (search.ship_count == 0) {
+        return -1;
+    }
+
+    search.config_count = 0;
+    memset(&partial, 0, sizeof(partial));
+    partial.ship_count = search.ship_count;
+    mask_clear(&placed);
+    if (list_configs(ds, &placed, 0, &partial, -1) != 0 || search.config_count == 0) {
+        return -1;
+    }
+
+    if (table_size != BOARD_SIZE) {
+        memset(table, 0, sizeof(table));
+        table_size = BOARD_SIZE;
+    }
+    for (k = 0; k < search.config_count; k++) {
+        items[k].config = (uint16_t)k;
+        items[k].hit = (uint16_t)initial_hits(ds, &search.configs[k]);
+    }
+
+    search.nodes = 0;
+    search.timed_out = 0;
+    solve(items, search.config_count, observation_key(ds), 1e30, &best_shot, &exact);
+    if (search.timed_out || !exact) {
+        /* Out of time - fall back on the square most configurations cover */
+        search.timed_out = 0;
+        return list_candidates(items, search.config_count, shots, counts) > 0 ? shots[0] : -1;
+    }
+    return best_shot;
+}
@@ -0,0 +1,572 @@
+/*
+ * enumerate.c - Exhaustive fleet layout enumerator
+ * Cross-platform: Windows (MSVC/MinGW) and UNIVAC 1219 (GCC)
+ *
+ * Counts every legal layout of the fleet under the rules
+ * is_correct_coordinates enforces, and how many of those layouts cover each
+ * square. Ships are placed largest first by a depth-first search over the
+ * legal_starts bitsets, so a dead end is never entered; the last ship is
+ * not placed at all, its legal starts are only counted.
+ *
+ * Two symmetries cut the search. The touching rule only looks along rows,
+ * so a layout stays legal when the board is mirrored left to right or top
+ * to bottom, but not when it is turned a quarter; the first ship is only
+ * tried in the smallest of its mirror images and every subtree is credited
+ * to each distinct image. Later ships of equal length are placed in
+ * increasing order of start square and the totals multiplied back up by
+ * the number of orderings.
+ *
+ * The work is one task per placement of the first two ships, handed out
+ * through a shared counter. Finished tasks are merged under a lock and, at
+ * every checkpoint interval, saved with the list of finished tasks; a run
+ * given the same checkpoint file carries on where the last one stopped.
+ * With -o the result is written as a placement prior, see prior.c. Counts
+ * are 64-bit, which holds the standard board with room to spare.
+ *
+ * Usage: battleship_enum [-t THREADS] [-o FILE] [-c FILE] [-i SECONDS] [-n] [-B SIZE] [-F SHIPS]
+ *        -o writes the placement prior to FILE
+ *        -c keeps a checkpoint in FILE and resumes from it
+ *        -i sets the checkpoint interval (default 60 seconds)
+ *        -n turns the mirror symmetry off, for cross-checking
+ *        -B and -F pick the board size and fleet in a DYNAMIC_BOARD build
+ */
+
+#include "battleship.h"
+
+#define MAX_THREADS 256
+#define DEFAULT_INTERVAL 60
+#define CHECKPOINT_VERSION 1
+#define MIRRORS 4                  /* identity, left-right, top-bottom, half turn */
+
+/* Checkpoint header, followed by one done byte per task and BOARD_CELLS 8-byte counts */
+typedef struct {
+    uint8_t magic[4];              /* "BSCK" */
+    uint8_t version;
+    uint8_t board_size;
+    uint8_t ship_count;
+    uint8_t mirrored;              /* 1 if mirror images were folded together */
+    uint8_t task_count[8];
+    uint8_t layouts[8];            /* merged so far, before the ordering factor */
+} CheckpointHeader;
+
+/* A placement of the first ship that stands for its mirror images */
+typedef struct {
+    int vertical;
+    int cell;
+    int images;                    /* bit g set for each distinct mirror image g */
+} FirstPlacement;
+
+/* Subtree under one placement of the first two ships */
+typedef struct {
+    int first;                     /* index into the first placements */
+    int vertical;                  /* second ship, cell -1 if the fleet has one ship */
+    int cell;
+} EnumTask;
+
+/* Work and results shared by all workers */
+typedef struct {
+    FirstPlacement* firsts;
+    EnumTask* tasks;
+    uint8_t* done;
+    long long task_count;
+    long long done_count;
+    long long resumed;
+    volatile long long next_task;
+    volatile long long lock;
+    int mirrored;
+    uint64_t layouts;
+    uint64_t occupancy[MAX_BOARD_CELLS];
+    const char* checkpoint_path;
+    double interval;
+    double last_checkpoint;
+} EnumRun;
+
+/* Per-thread counts for the task in hand */
+typedef struct {
+    EnumRun* run;
+    uint64_t occupancy[MAX_BOARD_CELLS];
+    uint64_t last_starts[2][MAX_BOARD_CELLS];
+} EnumWorker;
+
+/* Ship lengths in search order, and whether each follows an equal ship it must come after */
+static int lengths[MAX_SHIPS];
+static int ordered[MAX_SHIPS];
+
+/* Sort the fleet largest first and return the number of equal-ship orderings folded away */
+static uint64_t prepare_fleet(void) {
+    uint64_t factor = 1;
+    int i, j, run = 1, length;
+
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        length = fleet_ship_length(i);
+        for (j = i; j > 0 && lengths[j - 1] < length; j--) {
+            lengths[j] = lengths[j - 1];
+        }
+        lengths[j] = length;
+    }
+    /* Ships sharing the first ship's length stay unordered - the mirrors act on the first one */
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        ordered[i] = i > 0 && lengths[i] == lengths[i - 1] && lengths[i] != lengths[0];
+        run = ordered[i] ? run + 1 : 1;
+        factor *= (uint64_t)run;
+    }
+    return factor;
+}
+
+/* Square a mirror image g takes a square to */
+static int mirror_cell(int g, int cell) {
+    int row = cell / BOARD_SIZE;
+    int col = cell % BOARD_SIZE;
+
+    if (g & 1) col = BOARD_SIZE - 1 - col;
+    if (g & 2) row = BOARD_SIZE - 1 - row;
+    return row * BOARD_SIZE + col;
+}
+
+/* Start square of a placement's mirror image - the orientation is kept */
+static int mirror_start(int g, int vertical, int length, int cell) {
+    int a = mirror_cell(g, cell);
+    int b = mirror_cell(g, cell + (length - 1) * (vertical ? BOARD_SIZE : 1));
+    return a < b ? a : b;
+}
+
+/* Every first-ship placement that is the smallest of its mirror images - returns how many */
+static int list_firsts(FirstPlacement* firsts, int mirrored) {
+    int count = 0;
+    int vertical, cell, g, h, start, smallest, duplicate;
+    int starts[MIRRORS];
+
+    for (vertical = 0; vertical < 2; vertical++) {
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            if (!placement_fits(vertical, lengths[0], cell)) continue;
+
+            smallest = 1;
+            firsts[count].images = 1;
+            for (g = 1; g < (mirrored ? MIRRORS : 1); g++) {
+                start = mirror_start(g, vertical, lengths[0], cell);
+                starts[g] = start;
+                if (start < cell) smallest = 0;
+                duplicate = start == cell;
+                for (h = 1; h < g; h++) {
+                    if (starts[h] == start) duplicate = 1;
+                }
+                if (!duplicate) firsts[count].images |= 1 << g;
+            }
+            if (smallest) {
+                firsts[count].vertical = vertical;
+                firsts[count].cell = cell;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+/* Add a placement's squares to a mask */
+static void add_ship(BoardMask* ships, int vertical, int length, int cell) {
+    int step = vertical ? BOARD_SIZE : 1;
+    int k;
+
+    for (k = 0; k < length; k++, cell += step) {
+        mask_set(ships, cell);
+    }
+}
+
+/* Credit count layouts to each square of a placement */
+static void add_occupancy(uint64_t* occupancy, int vertical, int length, int cell, uint64_t count) {
+    int step = vertical ? BOARD_SIZE : 1;
+    int k;
+
+    for (k = 0; k < length; k++, cell += step) {
+        occupancy[cell] += count;
+    }
+}
+
+/* Cut the bits of squares 0 to cell out of a mask */
+static void clear_through(BoardMask* m, int cell) {
+    int i;
+
+    for (i = 0; i < MASK_WORDS && i * 64 <= cell; i++) {
+        if (cell - i * 64 >= 63) {
+            m->w[i] = 0;
+        } else {
+            m->w[i] &= ~(((uint64_t)2 << (cell - i * 64)) - 1);
+        }
+    }
+}
+
+/* Count completions of the fleet from ship depth on - key is the previous ship's placement */
+static uint64_t search(EnumWorker* w, const BoardMask* ships, int depth, int key) {
+    BoardMask starts[2], placed;
+    uint64_t total = 0, count, word;
+    int length = lengths[depth];
+    int vertical, i, cell;
+
+    legal_starts(ships, length, &starts[0], &starts[1]);
+
+    /* An equal ship goes after the previous one - keys are vertical * BOARD_CELLS + start */
+    if (ordered[depth]) {
+        if (key >= BOARD_CELLS) {
+            mask_clear(&starts[0]);
+            clear_through(&starts[1], key - BOARD_CELLS);
+        } else {
+            clear_through(&starts[0], key);
+        }
+    }
+
+    if (depth == NO_OF_SHIPS - 1) {
+        for (vertical = 0; vertical < 2; vertical++) {
+            for (i = 0; i < MASK_WORDS; i++) {
+                for (word = starts[vertical].w[i]; word != 0; word &= word - 1) {
+                    w->last_starts[vertical][i * 64 + lowest_bit(word)]++;
+                    total++;
+                }
+            }
+        }
+        return total;
+    }
+
+    for (vertical = 0; vertical < 2; vertical++) {
+        for (i = 0; i < MASK_WORDS; i++) {
+            for (word = starts[vertical].w[i]; word != 0; word &= word - 1) {
+                cell = i * 64 + lowest_bit(word);
+                placed = *ships;
+                add_ship(&placed, vertical, length, cell);
+                count = search(w, &placed, depth + 1, vertical * BOARD_CELLS + cell);
+                add_occupancy(w->occupancy, vertical, length, cell, count);
+                total += count;
+            }
+        }
+    }
+    return total;
+}
+
+/* Save the merged results - written aside and renamed, so a crash leaves the old one whole */
+static int write_checkpoint(const EnumRun* run) {
+    CheckpointHeader header;
+    char temp_path[1024];
+    uint8_t count[8];
+    FILE* file;
+    int cell, failed;
+
+    SAFE_SPRINTF(temp_path, sizeof(temp_path), "%s.tmp", run->checkpoint_path);
+    file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BSCK", 4);
+    header.version = CHECKPOINT_VERSION;
+    header.board_size = (uint8_t)BOARD_SIZE;
+    header.ship_count = (uint8_t)NO_OF_SHIPS;
+    header.mirrored = (uint8_t)run->mirrored;
+    record_put_u64(header.task_count, (uint64_t)run->task_count);
+    record_put_u64(header.layouts, run->layouts);
+
+    failed = fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(run->done, 1, (size_t)run->task_count, file) != (size_t)run->task_count;
+    for (cell = 0; cell < BOARD_CELLS && !failed; cell++) {
+        record_put_u64(count, run->occupancy[cell]);
+        failed = fwrite(count, sizeof(count), 1, file) != 1;
+    }
+    if (fclose(file) != 0 || failed) {
+        remove(temp_path);
+        return -1;
+    }
+    #ifdef _WIN32
+    remove(run->checkpoint_path);
+    #endif
+    return rename(temp_path, run->checkpoint_path) == 0 ? 0 : -1;
+}
+
+/* Pick up a checkpoint of the same run - returns 0 if resumed or there was none, -1 if it does not match */
+static int read_checkpoint(EnumRun* run) {
+    CheckpointHeader header;
+    uint8_t count[8];
+    FILE* file = fopen(run->checkpoint_path, "rb");
+    long long i;
+    int cell, failed;
+
+    if (file == NULL) {
+        return 0;
+    }
+    failed = fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, "BSCK", 4) != 0 || header.version != CHECKPOINT_VERSION ||
+        header.board_size != BOARD_SIZE || header.ship_count != NO_OF_SHIPS ||
+        header.mirrored != run->mirrored ||
+        record_u64(header.task_count) != (uint64_t)run->task_count ||
+        fread(run->done, 1, (size_t)run->task_count, file) != (size_t)run->task_count;
+    for (cell = 0; cell < BOARD_CELLS && !failed; cell++) {
+        failed = fread(count, sizeof(count), 1, file) != 1;
+        run->occupancy[cell] = record_u64(count);
+    }
+    fclose(file);
+    if (failed) {
+        return -1;
+    }
+
+    run->layouts = record_u64(header.layouts);
+    for (i = 0; i < run->task_count; i++) {
+        run->done_count += run->done[i] != 0;
+    }
+    run->resumed = run->done_count;
+    return 0;
+}
+
+/* Merge a finished task into the run, crediting every mirror image of its first ship */
+static void merge_task(EnumWorker* w, long long index, uint64_t layouts) {
+    EnumRun* run = w->run;
+    int images = run->firsts[run->tasks[index].first].images;
+    int g, cell;
+    double now;
+
+    spin_lock(&run->lock);
+    for (g = 0; g < MIRRORS; g++) {
+        if (!(images & (1 << g))) continue;
+        run->layouts += layouts;
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            run->occupancy[mirror_cell(g, cell)] += w->occupancy[cell];
+        }
+    }
+    run->done[index] = 1;
+    run->done_count++;
+
+    now = monotonic_seconds();
+    if (run->checkpoint_path != NULL && now - run->last_checkpoint >= run->interval) {
+        run->last_checkpoint = now;
+        if (write_checkpoint(run) != 0) {
+            printf("COULD NOT WRITE THE CHECKPOINT TO %s\n", run->checkpoint_path);
+        } else {
+            printf("CHECKPOINT:      %lld OF %lld TASKS\n", run->done_count, run->task_count);
+        }
+        fflush(stdout);
+    }
+    spin_unlock(&run->lock);
+}
+
+/* Count the layouts under one task */
+static void run_task(EnumWorker* w, long long index) {
+    const EnumTask* task = &w->run->tasks[index];
+    const FirstPlacement* first = &w->run->firsts[task->first];
+    BoardMask ships;
+    uint64_t layouts = 1;
+    int vertical, cell;
+
+    memset(w->occupancy, 0, sizeof(uint64_t) * (size_t)BOARD_CELLS);
+    mask_clear(&ships);
+    add_ship(&ships, first->vertical, lengths[0], first->cell);
+
+    if (task->cell >= 0) {
+        add_ship(&ships, task->vertical, lengths[1], task->cell);
+        if (NO_OF_SHIPS > 2) {
+            memset(w->last_starts, 0, sizeof(w->last_starts));
+            layouts = search(w, &ships, 2, task->vertical * BOARD_CELLS + task->cell);
+
+            /* Spread the last ship's start counts over its squares */
+            for (vertical = 0; vertical < 2; vertical++) {
+                for (cell = 0; cell < BOARD_CELLS; cell++) {
+                    if (w->last_starts[vertical][cell] != 0) {
+                        add_occupancy(w->occupancy, vertical, lengths[NO_OF_SHIPS - 1], cell,
+                            w->last_starts[vertical][cell]);
+                    }
+                }
+            }
+        }
+        add_occupancy(w->occupancy, task->vertical, lengths[1], task->cell, layouts);
+    }
+    add_occupancy(w->occupancy, first->vertical, lengths[0], first->cell, layouts);
+
+    merge_task(w, index, layouts);
+}
+
+/* Worker thread - claims tasks until none are left */
+static void enum_worker(void* arg) {
+    EnumWorker* w = (EnumWorker*)arg;
+    EnumRun* run = w->run;
+    long long index;
+
+    while ((index = sync_fetch_add(&run->next_task, 1)) < run->task_count) {
+        if (!run->done[index]) {
+            run_task(w, index);
+        }
+    }
+}
+
+/* Cut the search into tasks, one per placement of the first two ships - returns the count, -1 if out of memory */
+static long long build_tasks(EnumRun* run, int first_count) {
+    BoardMask ships, starts[2];
+    long long count = 0, capacity = 0;
+    int f, vertical, cell;
+
+    for (f = 0; f < first_count; f++) {
+        mask_clear(&ships);
+        add_ship(&ships, run->firsts[f].vertical, lengths[0], run->firsts[f].cell);
+        if (NO_OF_SHIPS > 1) {
+            legal_starts(&ships, lengths[1], &starts[0], &starts[1]);
+            capacity += mask_popcount(&starts[0]) + mask_popcount(&starts[1]);
+        } else {
+            capacity++;
+        }
+    }
+
+    run->tasks = (EnumTask*)malloc(sizeof(EnumTask) * (size_t)(capacity > 0 ? capacity : 1));
+    if (run->tasks == NULL) {
+        return -1;
+    }
+    for (f = 0; f < first_count; f++) {
+        if (NO_OF_SHIPS == 1) {
+            run->tasks[count].first = f;
+            run->tasks[count].vertical = 0;
+            run->tasks[count].cell = -1;
+            count++;
+            continue;
+        }
+        mask_clear(&ships);
+        add_ship(&ships, run->firsts[f].vertical, lengths[0], run->firsts[f].cell);
+        legal_starts(&ships, lengths[1], &starts[0], &starts[1]);
+        for (vertical = 0; vertical < 2; vertical++) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                if (mask_test(&starts[vertical], cell)) {
+                    run->tasks[count].first = f;
+                    run->tasks[count].vertical = vertical;
+                    run->tasks[count].cell = cell;
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    static EnumRun run;
+    EnumWorker* workers;
+    ThreadHandle threads[MAX_THREADS];
+    const char* prior_path = NULL;
+    char label[MAX_COORD_LENGTH];
+    FILE* prior_file;
+    uint64_t factor, layouts;
+    int thread_count = cpu_count();
+    int board_option = BOARD_SIZE, ships_option = NO_OF_SHIPS;
+    int first_count, i, cell;
+    double started, elapsed;
+
+    run.mirrored = 1;
+    run.interval = DEFAULT_INTERVAL;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            prior_path = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            run.checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            run.interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            run.mirrored = 0;
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            board_option = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            ships_option = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "USAGE: %s [-t THREADS] [-o FILE] [-c FILE] [-i SECONDS] [-n]"
+                " [-B SIZE] [-F SHIPS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (configure_board(board_option, ships_option) != 0) {
+        fprintf(stderr, "THIS BUILD CANNOT PLAY %dX%d WITH %d SHIPS\n", board_option, board_option, ships_option);
+        return 1;
+    }
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+
+    /* Placement tables must be ready before workers share them */
+    init_bitboards();
+    factor = prepare_fleet();
+
+    run.firsts = (FirstPlacement*)malloc(sizeof(FirstPlacement) * 2 * (size_t)BOARD_CELLS);
+    workers = (EnumWorker*)calloc((size_t)thread_count, sizeof(EnumWorker));
+    if (run.firsts == NULL || workers == NULL) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        return 1;
+    }
+    first_count = list_firsts(run.firsts, run.mirrored);
+    run.task_count = build_tasks(&run, first_count);
+    run.done = (uint8_t*)calloc((size_t)(run.task_count > 0 ? run.task_count : 1), 1);
+    if (run.task_count < 0 || run.done == NULL) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        return 1;
+    }
+    if (run.checkpoint_path != NULL && read_checkpoint(&run) != 0) {
+        fprintf(stderr, "CHECKPOINT %s IS FOR A DIFFERENT RUN\n", run.checkpoint_path);
+        return 1;
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        workers[i].run = &run;
+    }
+
+    started = monotonic_seconds();
+    run.last_checkpoint = started;
+    for (i = 1; i < thread_count; i++) {
+        if (thread_start(&threads[i], enum_worker, &workers[i]) != 0) {
+            fprintf(stderr, "FAILED TO START WORKER %d\n", i);
+            threads[i].impl = NULL;
+        }
+    }
+    enum_worker(&workers[0]);
+    for (i = 1; i < thread_count; i++) {
+        thread_join(&threads[i]);
+    }
+    elapsed = monotonic_seconds() - started;
+
+    if (run.checkpoint_path != NULL && write_checkpoint(&run) != 0) {
+        printf("COULD NOT WRITE THE CHECKPOINT TO %s\n", run.checkpoint_path);
+    }
+
+    /* Put back the orderings of equal ships that were folded away */
+    layouts = run.layouts * factor;
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        run.occupancy[cell] *= factor;
+    }
+
+    if (prior_path != NULL) {
+        prior_file = fopen(prior_path, "wb");
+        if (prior_file == NULL || write_placement_prior(prior_file, layouts, run.occupancy) != 0) {
+            fprintf(stderr, "COULD NOT WRITE THE PRIOR TO %s\n", prior_path);
+        }
+        if (prior_file != NULL) {
+            fclose(prior_file);
+        }
+    }
+
+    printf("========================================\n");
+    printf("   BATTLESHIP - FLEET ENUMERATOR\n");
+    printf("   PLATFORM: %s\n", PLATFORM_NAME);
+    printf("========================================\n");
+    printf("BOARD:           %dX%d, %d SHIPS\n", BOARD_SIZE, BOARD_SIZE, NO_OF_SHIPS);
+    printf("THREADS:         %d\n", thread_count);
+    printf("SYMMETRY:        %s\n", run.mirrored ? "MIRRORS" : "NONE");
+    printf("TASKS:           %lld (%lld FROM CHECKPOINT)\n", run.task_count, run.resumed);
+    printf("ELAPSED:         %.3f S\n", elapsed);
+    printf("LAYOUTS:         %llu\n", (unsigned long long)layouts);
+    printf("\nSHARE OF LAYOUTS COVERING EACH SQUARE (%%)\n");
+
+    for (i = 0; i < BOARD_SIZE; i++) {
+        format_row_label(i, label);
+        printf("%3s", label);
+        for (cell = i * BOARD_SIZE; cell < (i + 1) * BOARD_SIZE; cell++) {
+            printf(" %5.1f", layouts > 0 ? 100.0 * (double)run.occupancy[cell] / (double)layouts : 0.0);
+        }
+        printf("\n");
+    }
+
+    free(workers);
+    free(run.tasks);
+    free(run.done);
+    free(run.firsts);
+    return 0;
+}
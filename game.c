@@ -0,0 +1,135 @@
+/*
+ * game.c - Game state transitions for the engine library
+ * Cross-platform compatible
+ *
+ * A Game ties two placed fleets together, with an engine for each side the
+ * engine plays, and changes only through the functions below. Each one
+ * applies a shot or a salvo and returns what happened as result codes in a
+ * ShotReport: miss, hit or sunk, the ship that was hit and whether the game
+ * is over. None of them prints. A client that wants to show or record the
+ * game passes a GameObserver whose callbacks hear every shot and the end of
+ * the game; without one, simulators and services pay no stdio cost at all.
+ */
+
+#include "battleship.h"
+
+/* Fire at one square of a fleet - shooter, if not NULL, learns the result; returns the SHOT_ code */
+int fire_shot(Player* target, IntermediateAI* shooter, int cell, ShotReport* report) {
+    int row = cell_row(cell);
+    int col = cell_col(cell);
+    int ship = target->ship_at[cell];
+    int repeat = !is_hit(&target->arena, row, col) && !is_miss(&target->arena, row, col);
+
+    /* An engine's own picks are already recorded as pending - a repeat teaches it nothing,
+       and must not settle as a miss over a square it knows is a hit */
+    if (shooter != NULL) {
+        if (repeat) {
+            if (shooter->density.pending_cell == cell) {
+                shooter->density.pending_cell = -1;
+            }
+        } else if (shooter->density.pending_cell != cell) {
+            density_record_shot(&shooter->density, cell);
+        }
+    }
+
+    report->cell = cell;
+    report->ship = -1;
+    report->length = 0;
+    if (repeat) {
+        report->result = SHOT_REPEAT;
+    } else if (is_hit(&target->arena, row, col)) {
+        report->result = shooter != NULL ? ai_resolve_ship_hit(target, shooter, row, col) :
+            resolve_ship_hit(target, row, col);
+        report->ship = ship;
+        report->length = ship >= 0 ? target->ships[ship].length : 0;
+    } else {
+        place_piece(&target->arena, row, col, MISS);
+        report->result = SHOT_MISS;
+    }
+    report->game_over = target->ship_count == 0;
+    return report->result;
+}
+
+/* Start a game between two placed fleets - an engine of NULL leaves that side to the client */
+void game_begin(Game* g, Player* side0, IntermediateAI* engine0, Player* side1, IntermediateAI* engine1,
+    int first, const GameObserver* observer) {
+    g->sides[0] = side0;
+    g->sides[1] = side1;
+    g->engines[0] = engine0;
+    g->engines[1] = engine1;
+    g->observer = observer;
+    g->turn = first;
+    g->winner = -1;
+    g->shots[0] = 0;
+    g->shots[1] = 0;
+}
+
+/* Apply one shot of the side to move, telling the observer */
+static int game_shot(Game* g, int cell, ShotReport* report) {
+    int side = g->turn;
+
+    fire_shot(g->sides[1 - side], g->engines[side], cell, report);
+    g->shots[side]++;
+    if (g->observer != NULL && g->observer->shot != NULL) {
+        g->observer->shot(g->observer->context, side, report);
+    }
+    if (report->game_over && g->winner < 0) {
+        g->winner = side;
+        if (g->observer != NULL && g->observer->game_over != NULL) {
+            g->observer->game_over(g->observer->context, side);
+        }
+    }
+    return report->result;
+}
+
+/* The side to move fires at cell and the turn passes - returns the SHOT_ code */
+int game_fire(Game* g, int cell, ShotReport* report) {
+    int result = game_shot(g, cell, report);
+
+    g->turn = 1 - g->turn;
+    return result;
+}
+
+/* The engine of the side to move picks a square and fires - returns the SHOT_ code, or -1 without an engine */
+int game_engine_fire(Game* g, RandomStream* rng_state, ShotReport* report) {
+    IntermediateAI* engine = g->engines[g->turn];
+    char coord[MAX_COORD_LENGTH];
+
+    if (engine == NULL) {
+        return -1;
+    }
+    ai_fire_salvo(engine, coord, rng_state);
+    return game_fire(g, engine->previous_shot, report);
+}
+
+/* Shots the side to move fires under salvo rules - one per ship afloat */
+int game_salvo_size(const Game* g) {
+    return g->sides[g->turn]->ship_count;
+}
+
+/* The side to move fires a salvo and the turn passes - returns the shots fired, fewer if the game ends */
+int game_fire_salvo(Game* g, const int* cells, int count, ShotReport* reports) {
+    int i;
+
+    for (i = 0; i < count && g->winner < 0; i++) {
+        game_shot(g, cells[i], &reports[i]);
+    }
+    if (g->engines[g->turn] != NULL) {
+        density_settle(&g->engines[g->turn]->density);
+    }
+    g->turn = 1 - g->turn;
+    return i;
+}
+
+/* The engine of the side to move chooses a salvo together and fires it - returns the shots fired, -1 without an engine */
+int game_engine_salvo(Game* g, RandomStream* rng_state, ShotReport* reports) {
+    IntermediateAI* engine = g->engines[g->turn];
+    int cells[MAX_SHIPS];
+    int count;
+
+    if (engine == NULL) {
+        return -1;
+    }
+    count = ai_choose_salvo(engine, game_salvo_size(g), cells, rng_state);
+    return game_fire_salvo(g, cells, count, reports);
+}
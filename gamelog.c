@@ -0,0 +1,152 @@
+/*
+ * gamelog.c - Compact binary game records
+ * Cross-platform compatible
+ *
+ * A record is a GameRecord header holding the seed, engine levels and both
+ * fleet layouts, followed by one byte per shot: the encoded square in the
+ * low seven bits and GAME_LOG_HIT when it struck a ship. Shots alternate
+ * sides starting with the side that fired first. Records are written back
+ * to back, so a log file is simply a sequence of games. A shot byte holds
+ * at most 127 squares, so boards larger than 11x11 are not logged.
+ */
+
+#include "battleship.h"
+
+/* Store a 64-bit value little endian */
+void record_put_u64(uint8_t* bytes, uint64_t value) {
+    int i;
+    for (i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/* Little endian 64-bit field of a record */
+uint64_t record_u64(const uint8_t* bytes) {
+    uint64_t value = 0;
+    int i;
+    for (i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+/* Number of shot bytes following a record header */
+int record_shot_count(const GameRecord* record) {
+    return record->shot_count[0] | (record->shot_count[1] << 8);
+}
+
+/* Non-zero if the configured board fits in a shot byte */
+int game_log_supported(void) {
+    return BOARD_CELLS <= GAME_LOG_NO_SHOT;
+}
+
+/* Fleet entries per side in the header - version 1 records had one per ship */
+static int record_fleet_slots(const GameRecord* record) {
+    return record->version == 1 ? record->ship_count : record->fleet_slots;
+}
+
+/* Non-zero if a whole, compatible record starts here */
+int record_is_valid(const GameRecord* record, size_t available) {
+    if (available < sizeof(GameRecord)) {
+        return 0;
+    }
+    if (memcmp(record->magic, "BSGL", 4) != 0 ||
+        (record->version != 1 && record->version != GAME_LOG_VERSION) ||
+        record->board_size != BOARD_SIZE || record->ship_count != NO_OF_SHIPS ||
+        record_fleet_slots(record) != MAX_SHIPS) {
+        return 0;
+    }
+    return available - sizeof(GameRecord) >= (size_t)record_shot_count(record);
+}
+
+/* Start recording a game */
+void game_log_begin(GameLog* log, uint64_t seed, uint64_t game, int first, int level0, int level1) {
+    GameRecord* h = &log->header;
+
+    memset(h, 0, sizeof(GameRecord));
+    memcpy(h->magic, "BSGL", 4);
+    h->version = GAME_LOG_VERSION;
+    h->board_size = BOARD_SIZE;
+    h->ship_count = NO_OF_SHIPS;
+    h->fleet_slots = MAX_SHIPS;
+    h->first = (uint8_t)first;
+    h->levels[0] = (uint8_t)level0;
+    h->levels[1] = (uint8_t)level1;
+    h->winner = GAME_LOG_NO_WINNER;
+    record_put_u64(h->seed, seed);
+    record_put_u64(h->game, game);
+    log->shot_count = 0;
+}
+
+/* Record a side's fleet layout - call once the fleet is placed */
+void game_log_fleet(GameLog* log, int side, const Player* p) {
+    const Ship* s;
+    int i, vertical;
+
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        s = &p->ships[i];
+        vertical = s->length > 1 && s->cells[1] - s->cells[0] == BOARD_SIZE;
+        log->header.fleet[side][i][0] = (uint8_t)s->cells[0];
+        log->header.fleet[side][i][1] = (uint8_t)(s->length | (vertical ? 0x80 : 0));
+    }
+}
+
+/* Record the next shot - cell < 0 for a turn that fired at no square */
+void game_log_shot(GameLog* log, int cell, int is_hit) {
+    if (log->shot_count >= GAME_LOG_MAX_SHOTS) {
+        return;
+    }
+    if (cell < 0 || cell >= BOARD_CELLS) {
+        cell = GAME_LOG_NO_SHOT;
+        is_hit = 0;
+    }
+    log->shots[log->shot_count++] = (uint8_t)(cell | (is_hit ? GAME_LOG_HIT : 0));
+}
+
+/* GameObserver shot callback - appends the shot to the GameLog given as context */
+void game_log_observe(void* context, int side, const ShotReport* report) {
+    (void)side;
+    game_log_shot((GameLog*)context, report->cell, report->result == SHOT_HIT || report->result == SHOT_SUNK);
+}
+
+/* Close the record with the winning side, or GAME_LOG_NO_WINNER */
+void game_log_finish(GameLog* log, int winner) {
+    log->header.winner = (uint8_t)(winner < 0 ? GAME_LOG_NO_WINNER : winner);
+    log->header.shot_count[0] = (uint8_t)(log->shot_count & 0xFF);
+    log->header.shot_count[1] = (uint8_t)(log->shot_count >> 8);
+}
+
+/* Append a finished record to a file - returns 0 on success */
+int game_log_write(FILE* file, const GameLog* log) {
+    if (fwrite(&log->header, sizeof(GameRecord), 1, file) != 1) {
+        return -1;
+    }
+    if (log->shot_count > 0 &&
+        fwrite(log->shots, 1, (size_t)log->shot_count, file) != (size_t)log->shot_count) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Queue a finished record, flushing the batch first if it would not fit */
+void game_log_buffer_add(GameLogBuffer* buffer, const GameLog* log) {
+    size_t size = sizeof(GameRecord) + (size_t)log->shot_count;
+
+    if (buffer->used + size > GAME_LOG_BUFFER) {
+        game_log_buffer_flush(buffer);
+    }
+    memcpy(buffer->data + buffer->used, &log->header, sizeof(GameRecord));
+    memcpy(buffer->data + buffer->used + sizeof(GameRecord), log->shots, (size_t)log->shot_count);
+    buffer->used += size;
+}
+
+/* Append the batch to the shared file */
+void game_log_buffer_flush(GameLogBuffer* buffer) {
+    if (buffer->used == 0) {
+        return;
+    }
+    spin_lock(&buffer->sink->lock);
+    fwrite(buffer->data, 1, buffer->used, buffer->sink->file);
+    spin_unlock(&buffer->sink->lock);
+    buffer->used = 0;
+}
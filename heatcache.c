@@ -0,0 +1,215 @@
+/*
+ * heatcache.c - Heatmap cache shared by every game and thread
+ * Cross-platform compatible
+ *
+ * Many self-play games pass through the same observations - the empty
+ * board, the same first misses - and each would count the same heatmap
+ * again. Once heat_cache_init has sized the cache, compute_heatmap looks a
+ * position up by its Zobrist key (see observation_key) before counting and
+ * stores what it counted. Whole heatmaps are kept rather than best shots,
+ * so the engine still breaks ties with its own random stream and a game
+ * plays out the same with the cache on or off.
+ *
+ * The cache is a fixed array of buckets of HEAT_CACHE_WAYS slots and never
+ * grows. A slot's version is even while it holds a settled heatmap and odd
+ * while a writer fills it. A writer claims a slot with one compare-and-swap
+ * and gives up rather than wait if another thread holds it; a reader reads
+ * the version, then the key and heatmap, then the version again behind
+ * barriers, and keeps the heatmap only if the version did not move. No
+ * thread ever blocks. A full bucket evicts by the clock rule: its hand
+ * sweeps the slots, clearing the referenced bit of each slot hit since the
+ * last sweep, and takes the first slot without one.
+ *
+ * Lookups, hits, stores and evictions are counted for the hit-rate report.
+ * Lookups and hits go to a counter slot of the calling thread's own, as
+ * instrument.c does, so the lookup path shares no cache line between
+ * threads; the slots are summed by heat_cache_stats.
+ */
+
+#include "battleship.h"
+
+/* Slots per bucket */
+#define HEAT_CACHE_WAYS 4
+
+/* Lookup counter slots - threads past the last share it and may lose a few counts */
+#define HEAT_COUNTER_SLOTS 256
+
+/* One cached heatmap's key and state - the heatmap itself is in heats */
+typedef struct {
+    volatile long long version;     /* 0 if never filled, odd while being written */
+    volatile long long key;
+    volatile long long referenced;  /* hit since the clock hand last passed */
+} HeatSlot;
+
+/* One thread's lookup counts - padded to two 64-byte lines so that, however
+   the array is aligned, no two threads' counts share a line */
+typedef struct {
+    long long lookups;
+    long long hits;
+    char padding[128 - 2 * sizeof(long long)];
+} HeatCounters;
+
+static HeatSlot* slots = NULL;
+static int* heats = NULL;
+static volatile long long* hands = NULL;    /* clock hand per bucket */
+static long long bucket_count = 0;
+static int cache_cells = 0;                 /* squares per heatmap */
+
+static HeatCounters counters[HEAT_COUNTER_SLOTS];
+static volatile long long counters_claimed = 0;
+static THREAD_LOCAL HeatCounters* own_counters = NULL;
+static volatile long long stores = 0;
+static volatile long long evictions = 0;
+
+/* Size the cache to about bytes for the current board - returns 0, or -1 if out of memory */
+int heat_cache_init(size_t bytes) {
+    size_t per_bucket = HEAT_CACHE_WAYS * (sizeof(HeatSlot) + (size_t)BOARD_CELLS * sizeof(int)) +
+        sizeof(long long);
+    long long count = 1;
+
+    heat_cache_free();
+    while ((size_t)(count * 2) * per_bucket <= bytes) {
+        count *= 2;
+    }
+
+    slots = (HeatSlot*)calloc((size_t)count * HEAT_CACHE_WAYS, sizeof(HeatSlot));
+    heats = (int*)calloc((size_t)count * HEAT_CACHE_WAYS * (size_t)BOARD_CELLS, sizeof(int));
+    hands = (volatile long long*)calloc((size_t)count, sizeof(long long));
+    if (slots == NULL || heats == NULL || hands == NULL) {
+        heat_cache_free();
+        return -1;
+    }
+    bucket_count = count;
+    cache_cells = BOARD_CELLS;
+    memset(counters, 0, sizeof(counters));
+    stores = evictions = 0;
+    return 0;
+}
+
+/* Release the cache - compute_heatmap counts every heatmap again */
+void heat_cache_free(void) {
+    free(slots);
+    free(heats);
+    free((void*)hands);
+    slots = NULL;
+    heats = NULL;
+    hands = NULL;
+    bucket_count = 0;
+    cache_cells = 0;
+}
+
+/* Non-zero if heatmaps for this board are cached */
+int heat_cache_enabled(void) {
+    return slots != NULL && cache_cells == BOARD_CELLS;
+}
+
+/* First slot of the bucket a key falls in */
+static long long bucket_of(uint64_t key) {
+    return (long long)((key >> 32 ^ key) & (uint64_t)(bucket_count - 1)) * HEAT_CACHE_WAYS;
+}
+
+/* This thread's lookup counters, claiming a slot on first use */
+static HeatCounters* counter_slot(void) {
+    long long index;
+
+    if (own_counters == NULL) {
+        index = sync_fetch_add(&counters_claimed, 1);
+        own_counters = &counters[index < HEAT_COUNTER_SLOTS ? index : HEAT_COUNTER_SLOTS - 1];
+    }
+    return own_counters;
+}
+
+/* Copy the cached heatmap of a key into heat - returns 0 if it is not cached */
+int heat_cache_find(uint64_t key, int* heat) {
+    HeatCounters* counts = counter_slot();
+    long long first = bucket_of(key);
+    HeatSlot* s;
+    long long version;
+    int way;
+
+    counts->lookups++;
+    for (way = 0; way < HEAT_CACHE_WAYS; way++) {
+        s = &slots[first + way];
+        version = s->version;
+        if (version == 0 || (version & 1)) continue;
+
+        /* The key and heatmap are only read between two reads of the version */
+        sync_barrier();
+        if ((uint64_t)s->key != key) continue;
+        memcpy(heat, &heats[(first + way) * cache_cells], (size_t)cache_cells * sizeof(int));
+        sync_barrier();
+        if (s->version != version) {
+            /* Rewritten under us - count it as a miss */
+            return 0;
+        }
+        if (!s->referenced) {
+            s->referenced = 1;
+        }
+        counts->hits++;
+        return 1;
+    }
+    return 0;
+}
+
+/* Cache the heatmap of a key, evicting by the clock rule if its bucket is full */
+void heat_cache_store(uint64_t key, const int* heat) {
+    long long first = bucket_of(key);
+    HeatSlot* s = NULL;
+    long long version;
+    int way, step;
+
+    for (way = 0; way < HEAT_CACHE_WAYS; way++) {
+        version = slots[first + way].version;
+        if (version != 0 && (uint64_t)slots[first + way].key == key) {
+            return;
+        }
+        if (version == 0 && s == NULL) {
+            s = &slots[first + way];
+        }
+    }
+
+    /* Two sweeps find an unreferenced slot even if every slot was hit */
+    for (step = 0; s == NULL && step < 2 * HEAT_CACHE_WAYS; step++) {
+        way = (int)(sync_fetch_add(&hands[first / HEAT_CACHE_WAYS], 1) % HEAT_CACHE_WAYS);
+        if (slots[first + way].referenced) {
+            slots[first + way].referenced = 0;
+        } else {
+            s = &slots[first + way];
+        }
+    }
+    if (s == NULL) {
+        return;
+    }
+
+    version = s->version;
+    if ((version & 1) || sync_compare_swap(&s->version, version, version + 1) != version) {
+        return;
+    }
+    if (version != 0) {
+        sync_fetch_add(&evictions, 1);
+    }
+    s->key = (long long)key;
+    s->referenced = 0;
+    memcpy(&heats[(s - slots) * cache_cells], heat, (size_t)cache_cells * sizeof(int));
+    sync_barrier();
+    s->version = version + 2;
+    sync_fetch_add(&stores, 1);
+}
+
+/* Cache size and counters since heat_cache_init - call once the looking threads have finished */
+void heat_cache_stats(HeatCacheStats* stats) {
+    long long claimed = counters_claimed < HEAT_COUNTER_SLOTS ? counters_claimed : HEAT_COUNTER_SLOTS;
+    long long i;
+
+    stats->slots = bucket_count * HEAT_CACHE_WAYS;
+    stats->bytes = bucket_count * (HEAT_CACHE_WAYS * ((long long)sizeof(HeatSlot) +
+        (long long)cache_cells * (long long)sizeof(int)) + (long long)sizeof(long long));
+    stats->lookups = 0;
+    stats->hits = 0;
+    for (i = 0; i < claimed; i++) {
+        stats->lookups += counters[i].lookups;
+        stats->hits += counters[i].hits;
+    }
+    stats->stores = stores;
+    stats->evictions = evictions;
+}
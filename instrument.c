@@ -0,0 +1,175 @@
+/*
+ * instrument.c - Hot-path counters and their report
+ * Cross-platform compatible
+ *
+ * In a build with -DINSTRUMENT the STAT_ hooks in the engine count fleet
+ * placement work, is_correct_coordinates results by code, hunt and target
+ * shots, the size of the target frontier and the time ai_fire_salvo moves
+ * take. Reading the clock costs about as much as a move, so only one move
+ * in STAT_LATENCY_SAMPLE is timed. A thread claims a slot with one atomic
+ * add the first time it counts anything and from then on only touches its
+ * own slot, so the hooks take no locks. Threads past STAT_SLOTS share the
+ * last slot and may lose a few counts.
+ *
+ * The first claim registers an exit handler that sums the slots and writes
+ * the report to the file named by BATTLESHIP_STATS, or battleship_stats.json
+ * if it is not set. A name ending in .csv gives CSV, anything else JSON.
+ * Without -DINSTRUMENT nothing is counted and no report is written.
+ */
+
+#include "battleship.h"
+
+#define DEFAULT_REPORT "battleship_stats.json"
+
+static StatCounters slots[STAT_SLOTS];
+static volatile long long slots_claimed = 0;
+static THREAD_LOCAL StatCounters* own_slot = NULL;
+
+/* Names of the is_correct_coordinates results, in checks[] order */
+static const char* const check_names[STAT_CHECK_CODES] = {
+    "valid", "out_of_board", "misalign", "wrong_length", "crossing", "touching"
+};
+
+/* Write the report named by BATTLESHIP_STATS */
+static void write_report_at_exit(void) {
+    const char* path = getenv("BATTLESHIP_STATS");
+    size_t length;
+    FILE* file;
+
+    if (path == NULL || path[0] == '\0') {
+        path = DEFAULT_REPORT;
+    }
+    length = strlen(path);
+    file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "COULD NOT WRITE THE COUNTERS TO %s\n", path);
+        return;
+    }
+    stat_write_report(file, length >= 4 && strcmp(path + length - 4, ".csv") == 0);
+    fclose(file);
+}
+
+/* This thread's counters, claiming a slot on first use */
+StatCounters* stat_slot(void) {
+    long long index;
+
+    if (own_slot == NULL) {
+        index = sync_fetch_add(&slots_claimed, 1);
+        if (index == 0) {
+            atexit(write_report_at_exit);
+        }
+        own_slot = &slots[index < STAT_SLOTS ? index : STAT_SLOTS - 1];
+    }
+    return own_slot;
+}
+
+/* Count an is_correct_coordinates result */
+void stat_check(int code) {
+    int index;
+
+    switch (code) {
+        case VALID_COORD: index = 0; break;
+        case OUT_OF_BOARD: index = 1; break;
+        case MISALIGN: index = 2; break;
+        case WRONG_LENGTH: index = 3; break;
+        case CROSSING: index = 4; break;
+        default: index = 5; break;
+    }
+    stat_slot()->checks[index]++;
+}
+
+/* Count the target frontier size behind a target shot */
+void stat_frontier(int size) {
+    stat_slot()->frontier[size < STAT_FRONTIER_BUCKETS - 1 ? size : STAT_FRONTIER_BUCKETS - 1]++;
+}
+
+/* Count a move - non-zero if this one should be timed */
+int stat_time_move(void) {
+    return stat_slot()->moves++ % STAT_LATENCY_SAMPLE == 0;
+}
+
+/* Count one move's time in its power-of-two nanosecond bucket */
+void stat_move_latency(double seconds) {
+    double ns = seconds * 1e9;
+    int bucket = 0;
+
+    while (ns >= 2.0 && bucket < STAT_LATENCY_BUCKETS - 1) {
+        ns /= 2.0;
+        bucket++;
+    }
+    stat_slot()->latency[bucket]++;
+}
+
+/* Sum every slot - call once the counting threads have finished */
+void stat_totals(StatCounters* total) {
+    long long claimed = slots_claimed < STAT_SLOTS ? slots_claimed : STAT_SLOTS;
+    const StatCounters* s;
+    long long i;
+    int k;
+
+    memset(total, 0, sizeof(StatCounters));
+    for (i = 0; i < claimed; i++) {
+        s = &slots[i];
+        total->ship_placements += s->ship_placements;
+        total->ship_no_room += s->ship_no_room;
+        total->fleet_attempts += s->fleet_attempts;
+        total->moves += s->moves;
+        total->hunt_shots += s->hunt_shots;
+        total->target_shots += s->target_shots;
+        for (k = 0; k < STAT_CHECK_CODES; k++) total->checks[k] += s->checks[k];
+        for (k = 0; k < STAT_FRONTIER_BUCKETS; k++) total->frontier[k] += s->frontier[k];
+        for (k = 0; k < STAT_LATENCY_BUCKETS; k++) total->latency[k] += s->latency[k];
+    }
+}
+
+/* Write the summed counters as JSON, or as name,value CSV lines - returns 0 on success */
+int stat_write_report(FILE* file, int csv) {
+    StatCounters total;
+    int k;
+
+    stat_totals(&total);
+
+    if (csv) {
+        fprintf(file, "counter,value\n");
+        fprintf(file, "threads,%lld\n", slots_claimed);
+        fprintf(file, "ship_placements,%lld\n", total.ship_placements);
+        fprintf(file, "ship_no_room,%lld\n", total.ship_no_room);
+        fprintf(file, "fleet_attempts,%lld\n", total.fleet_attempts);
+        for (k = 0; k < STAT_CHECK_CODES; k++) {
+            fprintf(file, "check_%s,%lld\n", check_names[k], total.checks[k]);
+        }
+        fprintf(file, "moves,%lld\n", total.moves);
+        fprintf(file, "hunt_shots,%lld\n", total.hunt_shots);
+        fprintf(file, "target_shots,%lld\n", total.target_shots);
+        for (k = 0; k < STAT_FRONTIER_BUCKETS; k++) {
+            fprintf(file, "frontier_%d,%lld\n", k, total.frontier[k]);
+        }
+        for (k = 0; k < STAT_LATENCY_BUCKETS; k++) {
+            fprintf(file, "latency_ns_%.0f,%lld\n", (double)((uint64_t)1 << k), total.latency[k]);
+        }
+        fprintf(file, "latency_sample,%d\n", STAT_LATENCY_SAMPLE);
+        return ferror(file) ? -1 : 0;
+    }
+
+    fprintf(file, "{\n  \"platform\": \"%s\",\n  \"threads\": %lld,\n", PLATFORM_NAME, slots_claimed);
+    fprintf(file, "  \"placement\": {\"ship_placements\": %lld, \"ship_no_room\": %lld, "
+        "\"fleet_attempts\": %lld},\n",
+        total.ship_placements, total.ship_no_room, total.fleet_attempts);
+    fprintf(file, "  \"checks\": {");
+    for (k = 0; k < STAT_CHECK_CODES; k++) {
+        fprintf(file, "%s\"%s\": %lld", k ? ", " : "", check_names[k], total.checks[k]);
+    }
+    fprintf(file, "},\n  \"shots\": {\"moves\": %lld, \"hunt\": %lld, \"target\": %lld},\n",
+        total.moves, total.hunt_shots, total.target_shots);
+    fprintf(file, "  \"target_frontier\": [");
+    for (k = 0; k < STAT_FRONTIER_BUCKETS; k++) {
+        fprintf(file, "%s%lld", k ? ", " : "", total.frontier[k]);
+    }
+    fprintf(file, "],\n  \"latency_sample\": %d,\n  \"move_latency_ns\": [", STAT_LATENCY_SAMPLE);
+    for (k = 0; k < STAT_LATENCY_BUCKETS; k++) {
+        fprintf(file, "%s{\"from\": %.0f, \"count\": %lld}", k ? ", " : "",
+            (double)((uint64_t)1 << k), total.latency[k]);
+    }
+    fprintf(file, "]\n}\n");
+    return ferror(file) ? -1 : 0;
+}
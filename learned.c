@@ -0,0 +1,225 @@
+/*
+ * learned.c - Learned opponent placement model
+ * Cross-platform compatible
+ *
+ * Counts where one opponent has put their ships, game after game. For every
+ * finished game the revealed fleet adds one to each square a ship covered
+ * and one to each placement (orientation, length and start square) it used.
+ * The counts live in a fixed-layout file, a header and then little endian
+ * 4-byte counters, which is mapped and read in one pass at startup.
+ *
+ * Updates never touch the file in place. The new counts are written to a
+ * temporary file beside it, which then replaces the old one in one rename,
+ * so a reader or a crash mid-save sees either the old model or the new one.
+ *
+ * Hunting draws squares through the placement prior weights in prior.c.
+ * A square's count is what was seen plus LEARNED_PSEUDO_GAMES games of
+ * uniformly placed ships, so a young model leans on the geometry of the
+ * board and an old one on the opponent's habits. The Advanced engine also
+ * weights every placement in its heatmap, while hunting and while
+ * targeting, by how often the opponent has used it. Each change to the
+ * counts bumps the model's version, which keys cached heatmaps.
+ */
+
+#include "battleship.h"
+
+/* Games of uniform placement blended into every square's count */
+#define LEARNED_PSEUDO_GAMES 4
+
+/* Fixed-point scale of the counts handed to the prior weights */
+#define LEARNED_COUNT_SCALE 1024
+
+/* Extra weight of a placement the opponent used in every game */
+#define LEARNED_PLACEMENT_SCALE 8
+
+static uint32_t cell_count[MAX_BOARD_CELLS];
+static uint32_t placement_count[2][MAX_SHIP_LENGTH][MAX_BOARD_CELLS];
+static uint64_t games = 0;
+static int learned_size = 0;           /* board size of the loaded model, 0 if none */
+static uint64_t model_version = 0;     /* bumped whenever the counts change */
+
+/* Size in bytes of a model file for the configured board */
+static size_t learned_file_size(void) {
+    return sizeof(LearnedHeader) + (size_t)BOARD_CELLS * 4 * (1 + 2 * MAX_SHIP_LENGTH);
+}
+
+/* Little endian 4-byte counter */
+static uint32_t read_u32(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+        ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/* Write a little endian 4-byte counter */
+static void write_u32(uint8_t* bytes, uint32_t value) {
+    bytes[0] = (uint8_t)(value & 0xFF);
+    bytes[1] = (uint8_t)((value >> 8) & 0xFF);
+    bytes[2] = (uint8_t)((value >> 16) & 0xFF);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+/* Hand the seen counts, blended with uniform placement, to the hunting prior */
+static void apply_learned_prior(void) {
+    static uint64_t blended[MAX_BOARD_CELLS];
+    static double uniform[MAX_BOARD_CELLS];
+    BoardMask empty;
+    int starts, length, vertical, cell, i, c, s;
+
+    /* Squares a uniformly placed ship of each length covers, per game */
+    mask_clear(&empty);
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        uniform[cell] = 0.0;
+    }
+    for (s = 0; s < NO_OF_SHIPS; s++) {
+        length = fleet_ship_length(s);
+        starts = 0;
+        for (vertical = 0; vertical < 2; vertical++) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                starts += placement_fits(vertical, length, cell);
+            }
+        }
+        if (starts == 0) continue;
+        for (vertical = 0; vertical < 2; vertical++) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                if (!placement_fits(vertical, length, cell)) continue;
+                for (i = 0, c = cell; i < length; i++, c += vertical ? BOARD_SIZE : 1) {
+                    uniform[c] += 1.0 / starts;
+                }
+            }
+        }
+    }
+
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        blended[cell] = (uint64_t)(LEARNED_COUNT_SCALE *
+            (cell_count[cell] + LEARNED_PSEUDO_GAMES * uniform[cell]));
+    }
+    set_placement_prior(blended);
+}
+
+/* Load the model for the configured board - a missing file starts an empty one; returns -1 for another board */
+int load_learned_prior(const char* path) {
+    const uint8_t* base;
+    const uint8_t* counter;
+    const LearnedHeader* header;
+    size_t size = 0;
+    int vertical, length, cell;
+
+    memset(cell_count, 0, sizeof(cell_count));
+    memset(placement_count, 0, sizeof(placement_count));
+    games = 0;
+    learned_size = 0;
+
+    base = (const uint8_t*)map_file(path, &size);
+    if (base != NULL) {
+        header = (const LearnedHeader*)base;
+        if (size != learned_file_size() || memcmp(header->magic, "BSLM", 4) != 0 ||
+            header->version != LEARNED_VERSION || header->board_size != BOARD_SIZE ||
+            header->ship_count != NO_OF_SHIPS || header->max_length != MAX_SHIP_LENGTH) {
+            unmap_file(base, size);
+            return -1;
+        }
+        games = record_u64(header->games);
+        counter = base + sizeof(LearnedHeader);
+        for (cell = 0; cell < BOARD_CELLS; cell++, counter += 4) {
+            cell_count[cell] = read_u32(counter);
+        }
+        for (vertical = 0; vertical < 2; vertical++) {
+            for (length = 0; length < MAX_SHIP_LENGTH; length++) {
+                for (cell = 0; cell < BOARD_CELLS; cell++, counter += 4) {
+                    placement_count[vertical][length][cell] = read_u32(counter);
+                }
+            }
+        }
+        unmap_file(base, size);
+    }
+
+    learned_size = BOARD_SIZE;
+    model_version++;
+    apply_learned_prior();
+    return 0;
+}
+
+/* Count the revealed fleet of a finished game */
+void learned_prior_record(const Player* p) {
+    const Ship* s;
+    int i, k, vertical;
+
+    if (learned_size != BOARD_SIZE) {
+        return;
+    }
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        s = &p->ships[i];
+        if (s->length < 1 || s->length > MAX_SHIP_LENGTH) continue;
+        vertical = s->length > 1 && s->cells[1] - s->cells[0] == BOARD_SIZE;
+        placement_count[vertical][s->length - 1][s->cells[0]]++;
+        for (k = 0; k < s->length; k++) {
+            cell_count[s->cells[k]]++;
+        }
+    }
+    games++;
+    model_version++;
+    apply_learned_prior();
+}
+
+/* Save the model by replacing path with a complete new file - returns 0 on success */
+int save_learned_prior(const char* path) {
+    char temp[FILENAME_MAX];
+    LearnedHeader header;
+    uint8_t counter[4];
+    FILE* file;
+    int vertical, length, cell, failed = 0;
+
+    if (learned_size != BOARD_SIZE || strlen(path) + 5 > sizeof(temp)) {
+        return -1;
+    }
+    SAFE_SPRINTF(temp, sizeof(temp), "%s.tmp", path);
+    file = fopen(temp, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BSLM", 4);
+    header.version = LEARNED_VERSION;
+    header.board_size = (uint8_t)BOARD_SIZE;
+    header.ship_count = (uint8_t)NO_OF_SHIPS;
+    header.max_length = (uint8_t)MAX_SHIP_LENGTH;
+    record_put_u64(header.games, games);
+    failed |= fwrite(&header, sizeof(header), 1, file) != 1;
+    for (cell = 0; cell < BOARD_CELLS && !failed; cell++) {
+        write_u32(counter, cell_count[cell]);
+        failed |= fwrite(counter, sizeof(counter), 1, file) != 1;
+    }
+    for (vertical = 0; vertical < 2; vertical++) {
+        for (length = 0; length < MAX_SHIP_LENGTH; length++) {
+            for (cell = 0; cell < BOARD_CELLS && !failed; cell++) {
+                write_u32(counter, placement_count[vertical][length][cell]);
+                failed |= fwrite(counter, sizeof(counter), 1, file) != 1;
+            }
+        }
+    }
+    failed |= fclose(file) != 0;
+
+    if (failed || replace_file(temp, path) != 0) {
+        remove(temp);
+        return -1;
+    }
+    return 0;
+}
+
+/* Games the loaded model has counted */
+long long learned_prior_games(void) {
+    return learned_size == BOARD_SIZE ? (long long)games : 0;
+}
+
+/* Version of the counts - changes whenever a placement weight may have */
+uint64_t learned_prior_version(void) {
+    return model_version;
+}
+
+/* Weight of a placement by how often the opponent used it - 1 without a model */
+int learned_placement_weight(int vertical, int length, int cell) {
+    if (learned_size != BOARD_SIZE || games == 0 || length < 1 || length > MAX_SHIP_LENGTH) {
+        return 1;
+    }
+    return 1 + (int)(LEARNED_PLACEMENT_SCALE * (uint64_t)placement_count[vertical][length - 1][cell] / games);
+}
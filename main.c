@@ -3,30 +3,201 @@
  * Cross-platform: Windows (MSVC/MinGW) and UNIVAC 1219 (GCC)
  * 
  * Implements Battleship game with Intermediate Adversary AI
- * Uses XorShift RNG seeded with time(0) for UNIVAC compatibility
+ * Uses a seedable RNG seeded with time(0) for UNIVAC compatibility
+ *
+ * Usage: battleship [-l FILE] [-q | -d] [-P FILE] [-B SIZE] [-F SHIPS] [-S]
+ *        -l appends a binary record of the game to FILE, see gamelog.c
+ *        -P loads a placement prior that guides the engine's hunting, see prior.c
+ *        -L learns where you put your ships across games in FILE, see learned.c
+ *        -q skips drawing the boards, -d redraws only the squares that changed
+ *        -B and -F pick the board size and fleet in a DYNAMIC_BOARD build
+ *        -S plays salvo rules - each side fires one shot per ship it has afloat
  */
 
 #include "battleship.h"
 
+/* Prompt until a square on the board is typed - returns it, or -1 when input runs out */
+static int read_coordinate(const char* prompt) {
+    char input[100];
+    int cell, code;
+    
+    while (1) {
+        printf("%s", prompt);
+        input[0] = '\0';
+        get_input(input, sizeof(input));
+        code = parse_coord(input, &cell);
+        if (code == VALID_COORD) {
+            return cell;
+        }
+        if (feof(stdin)) {
+            return -1;
+        }
+        printf("%s\n", coord_error_text(code));
+    }
+}
+
+/* Prompt for a salvo of count distinct squares - returns 0, or -1 when input runs out */
+static int read_salvo(int count, int* cells) {
+    char prompt[64];
+    int n, k;
+    
+    printf("FIRE %d SHOT%s THIS TURN\n", count, count == 1 ? "" : "S");
+    for (n = 0; n < count; n++) {
+        SAFE_SPRINTF(prompt, sizeof(prompt), "ENTER COORDINATES FOR SHOT %d OF %d: ", n + 1, count);
+        cells[n] = read_coordinate(prompt);
+        if (cells[n] < 0) {
+            return -1;
+        }
+        for (k = 0; k < n; k++) {
+            if (cells[k] == cells[n]) break;
+        }
+        if (k < n) {
+            printf("THAT SQUARE IS ALREADY IN THIS SALVO!\n");
+            n--;
+        }
+    }
+    return 0;
+}
+
+/* What the console shows and records as the game plays out */
+typedef struct {
+    GameLog* log;
+    int salvo_rules;
+    char last_engine_shot[MAX_COORD_LENGTH];
+} ConsoleView;
+
+/* GameObserver shot callback - print the shot and add it to the game record */
+static void console_shot(void* context, int side, const ShotReport* report) {
+    ConsoleView* view = (ConsoleView*)context;
+    char coord[MAX_COORD_LENGTH];
+    
+    game_log_observe(view->log, side, report);
+    decode_coord(report->cell, coord);
+    if (side == 1) {
+        SAFE_STRCPY(view->last_engine_shot, coord, MAX_COORD_LENGTH);
+    }
+    
+    /* A salvo is listed one shot per line */
+    if (view->salvo_rules) {
+        switch (report->result) {
+            case SHOT_SUNK: printf("  %s - HIT AND SUNK!\n", coord); break;
+            case SHOT_HIT: printf("  %s - HIT\n", coord); break;
+            case SHOT_MISS: printf("  %s - MISS\n", coord); break;
+            default: printf("  %s - ALREADY FIRED AT\n", coord); break;
+        }
+        return;
+    }
+    
+    if (side == 1) {
+        printf("THE ENGINE FIRED AT %s\n", coord);
+    }
+    switch (report->result) {
+        case SHOT_SUNK:
+            printf("YOU SANK A SHIP!\n");
+            break;
+        case SHOT_HIT:
+            printf("YOU HIT A SHIP!\n");
+            break;
+        case SHOT_MISS:
+            if (side == 0) {
+                printf("YOU MISSED! TRY AGAIN NEXT TURN\n");
+            } else {
+                printf("THE ENGINE FIRED AT %s AND MISSED.\n", coord);
+            }
+            break;
+        default:
+            if (side == 0) {
+                printf("ALREADY FIRED AT THIS LOCATION!\n");
+            }
+            break;
+    }
+}
+
 int main(int argc, char* argv[]) {
+    static Renderer renderer;
+    static Speculation speculation;
+    RenderSide enemy_side, own_side;
+    char status[MAX_NAME_LENGTH * 2];
+    ConsoleView view;
+    GameObserver console;
+    Game game;
+    ShotReport report;
+    ShotReport reports[MAX_SHIPS];
+    int render_mode = RENDER_FULL;
     Player human;
     Player ai_player;
     IntermediateAI ai_engine;
-    unsigned int rng_state;
+    RandomStream rng_state;
+    GameLog game_log;
+    const char* log_path = NULL;
+    const char* prior_path = NULL;
+    const char* learned_path = NULL;
+    FILE* log_file;
+    uint64_t seed;
     char input[100];
-    char shot[MAX_COORD_LENGTH];
-    char shot_row;
-    int shot_col;
+    int salvo[MAX_SHIPS];
+    int salvo_rules = 0;
+    int cell, second, count;
+    int board_option = BOARD_SIZE, ships_option = NO_OF_SHIPS;
     int i;
     int did_p1_win = 0;
     
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0) {
+            render_mode = RENDER_QUIET;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            render_mode = RENDER_DIFF;
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            prior_path = argv[++i];
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            learned_path = argv[++i];
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            board_option = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            ships_option = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-S") == 0) {
+            salvo_rules = 1;
+        }
+    }
+    if (configure_board(board_option, ships_option) != 0) {
+        printf("THIS BUILD CANNOT PLAY %dX%d WITH %d SHIPS\n", board_option, board_option, ships_option);
+        return 1;
+    }
+    if (log_path != NULL && salvo_rules) {
+        printf("GAME LOGS RECORD ONE SHOT A TURN - -l CANNOT BE USED WITH -S\n");
+        return 1;
+    }
+    if (log_path != NULL && !game_log_supported()) {
+        printf("GAME LOGS HOLD BOARDS OF AT MOST %d SQUARES\n", GAME_LOG_NO_SHOT);
+        return 1;
+    }
+    if (prior_path != NULL && learned_path != NULL) {
+        printf("-P AND -L BOTH GUIDE THE ENGINE'S HUNTING - CHOOSE ONE\n");
+        return 1;
+    }
+    if (prior_path != NULL && load_placement_prior(prior_path) != 0) {
+        printf("CANNOT LOAD A PRIOR FOR THIS BOARD FROM %s\n", prior_path);
+        return 1;
+    }
+    if (learned_path != NULL && load_learned_prior(learned_path) != 0) {
+        printf("%s HOLDS A MODEL FOR ANOTHER BOARD OR FLEET\n", learned_path);
+        return 1;
+    }
+    init_renderer(&renderer, render_mode);
+    
     printf("\n========================================\n");
-    printf("   BATTLESHIP - INTERMEDIATE AI\n");
+    printf("   BATTLESHIP - INTERMEDIATE AI%s\n", salvo_rules ? " - SALVO RULES" : "");
     printf("   PLATFORM: %s\n", PLATFORM_NAME);
+    if (learned_path != NULL) {
+        printf("   LEARNED FROM %lld GAMES\n", learned_prior_games());
+    }
     printf("========================================\n\n");
     
     /* Initialize random number generator */
-    init_random(&rng_state);
+    seed = time_seed();
+    random_seed(&rng_state, seed);
     
     /* Menu 1: Action Menu */
     printf("WHAT WOULD YOU LIKE TO DO?\n");
@@ -43,9 +214,20 @@ int main(int argc, char* argv[]) {
     get_input(input, sizeof(input));
     init_player(&human, input);
     
-    /* Initialize AI player */
-    init_player(&ai_player, "INTERMEDIATE AI");
-    init_intermediate_ai(&ai_engine);
+    /* Select and initialize AI player */
+    printf("\nSELECT THE ENGINE LEVEL\n");
+    printf("\t[I]NTERMEDIATE\n\t[A]DVANCED\n");
+    get_input(input, sizeof(input));
+    
+    if (input[0] == 'a' || input[0] == 'A') {
+        init_player(&ai_player, "ADVANCED AI");
+        init_advanced_ai(&ai_engine);
+    } else {
+        init_player(&ai_player, "INTERMEDIATE AI");
+        init_intermediate_ai(&ai_engine);
+    }
+    set_endgame_budget(&ai_engine, ENDGAME_DEFAULT_BUDGET);
+    game_log_begin(&game_log, seed, 0, 0, GAME_LOG_HUMAN, ai_engine.level);
     
     printf("\n========================================\n");
     printf("   GAME SETUP\n");
@@ -53,31 +235,26 @@ int main(int argc, char* argv[]) {
     
     /* Human places ships */
     printf("PLAYER 1, PLACE YOUR SHIPS ON THE GAME FIELD\n");
-    print_battlefield(&human.arena, 0);
+    if (render_mode != RENDER_QUIET) {
+        print_battlefield(&human.arena, 0);
+    }
     
     for (i = 0; i < NO_OF_SHIPS; i++) {
-        char roF, roS;
+        int roF, roS;
         int coF, coS;
         int placement_res;
         
         printf("\nPLACE %s (LENGTH %d)\n", human.ships[i].name, human.ships[i].length);
-        printf("ENTER FIRST COORDINATE (E.G., A1): ");
-        get_input(input, sizeof(input));
-        roF = input[0];
-        #ifdef _MSC_VER
-        sscanf_s(input + 1, "%d", &coF);
-        #else
-        sscanf(input + 1, "%d", &coF);
-        #endif
-        
-        printf("ENTER SECOND COORDINATE (E.G., A5): ");
-        get_input(input, sizeof(input));
-        roS = input[0];
-        #ifdef _MSC_VER
-        sscanf_s(input + 1, "%d", &coS);
-        #else
-        sscanf(input + 1, "%d", &coS);
-        #endif
+        cell = read_coordinate("ENTER FIRST COORDINATE (E.G., A1): ");
+        second = cell < 0 ? -1 : read_coordinate("ENTER SECOND COORDINATE (E.G., A5): ");
+        if (second < 0) {
+            printf("\nNO MORE INPUT - EXITING GAME\n");
+            return 1;
+        }
+        roF = cell_row(cell);
+        coF = cell_col(cell);
+        roS = cell_row(second);
+        coS = cell_col(second);
         
         /* Normalize coordinates */
         normalize_coordinates(&roF, &roS, &coF, &coS);
@@ -92,98 +269,112 @@ int main(int argc, char* argv[]) {
         }
         
         /* Place ship on battlefield */
-        if (roF == roS) {
-            int j;
-            for (j = coF; j <= coS; j++) {
-                place_piece(&human.arena, roF, j, SHIP_PIECE);
-            }
-        } else {
-            char j;
-            for (j = roF; j <= roS; j++) {
-                place_piece(&human.arena, j, coF, SHIP_PIECE);
-            }
+        place_ship(&human, i, roF, roS, coF, coS);
+        if (render_mode != RENDER_QUIET) {
+            print_battlefield(&human.arena, 0);
         }
-        
-        store_ship_placement(&human.ships[i], roF, roS, coF, coS);
-        print_battlefield(&human.arena, 0);
     }
     
     prompt_enter_key();
     
     /* AI places ships */
     printf("\nKINDLY WAIT WHILE THE MACHINE PLACES ITS SHIPS\n");
-    for (i = 0; i < NO_OF_SHIPS; i++) {
-        ai_place_ship(&ai_player, i, &rng_state);
+    if (ai_place_fleet(&ai_player, &rng_state) != VALID_COORD) {
+        printf("THE MACHINE COULD NOT FIT ITS FLEET ON THE BOARD!\n");
+        return 1;
     }
+    game_log_fleet(&game_log, 0, &human);
+    game_log_fleet(&game_log, 1, &ai_player);
     printf("\nTHE MACHINE HAS COMPLETED PLACING ITS SHIPS!\n\n");
-    print_battlefield(&ai_player.arena, 0);
+    if (render_mode != RENDER_QUIET) {
+        print_battlefield(&ai_player.arena, 0);
+    }
     
     prompt_enter_key();
     
     /* Wartime - Main game loop */
     printf("THE GAME STARTS!\n\n");
     
-    while (1) {
-        /* Display both battlefields */
-        printf("ENEMY BATTLEFIELD:\n");
-        print_battlefield(&ai_player.arena, 1);
-        print_divider();
-        printf("YOUR BATTLEFIELD:\n");
-        print_battlefield(&human.arena, 0);
-        
-        /* Human fires */
-        printf("ENTER COORDINATES TO FIRE AT (E.G., B5): ");
-        get_input(input, sizeof(input));
-        SAFE_STRCPY(shot, input, MAX_COORD_LENGTH);
-        shot_row = shot[0];
-        #ifdef _MSC_VER
-        sscanf_s(shot + 1, "%d", &shot_col);
-        #else
-        sscanf(shot + 1, "%d", &shot_col);
-        #endif
+    enemy_side.title = "ENEMY BATTLEFIELD:";
+    enemy_side.board = &ai_player.arena;
+    enemy_side.cloaked = 1;
+    own_side.title = "YOUR BATTLEFIELD:";
+    own_side.board = &human.arena;
+    own_side.cloaked = 0;
+    view.log = &game_log;
+    view.salvo_rules = salvo_rules;
+    SAFE_STRCPY(view.last_engine_shot, "NONE", MAX_COORD_LENGTH);
+    console.shot = console_shot;
+    console.game_over = NULL;
+    console.context = &view;
+    game_begin(&game, &human, NULL, &ai_player, &ai_engine, 0, &console);
+    
+    while (game.winner < 0) {
+        /* Display both battlefields side by side in one frame */
+        SAFE_SPRINTF(status, sizeof(status), "SHIPS AFLOAT - ENEMY: %d  YOURS: %d  LAST ENGINE SHOT: %s\n",
+            ai_player.ship_count, human.ship_count, view.last_engine_shot);
+        render_frame(&renderer, &enemy_side, &own_side, status);
         
-        /* Process human shot */
-        if (is_hit(&ai_player.arena, shot_row, shot_col)) {
-            ai_manage_ship_hit(&ai_player, &ai_engine, shot_row, shot_col);
-        } else if (is_miss(&ai_player.arena, shot_row, shot_col)) {
-            place_piece(&ai_player.arena, shot_row, shot_col, MISS);
-            printf("YOU MISSED! TRY AGAIN NEXT TURN\n");
+        /* The engine works out its reply while the human types - each human shot sinks one ship at most */
+        if (salvo_rules) {
+            speculation_start(&speculation, &ai_engine, &rng_state, ai_player.ship_count,
+                ai_player.ship_count - human.ship_count);
         } else {
-            printf("ALREADY FIRED AT THIS LOCATION!\n");
-        }
-        
-        /* Check if human won */
-        if (is_navy_sunken(&ai_player)) {
-            did_p1_win = 1;
-            break;
+            speculation_start(&speculation, &ai_engine, &rng_state, 0, 0);
         }
         
-        /* AI fires */
-        printf("\nPLEASE WAIT WHILE THE ENGINE MAKES ITS MOVE\n");
-        ai_fire_salvo(&ai_engine, shot, &rng_state);
-        printf("THE ENGINE FIRED AT %s\n", shot);
-        shot_row = shot[0];
-        #ifdef _MSC_VER
-        sscanf_s(shot + 1, "%d", &shot_col);
-        #else
-        sscanf(shot + 1, "%d", &shot_col);
-        #endif
-        
-        /* Process AI shot */
-        if (is_hit(&human.arena, shot_row, shot_col)) {
-            manage_ship_hit(&human, shot_row, shot_col);
-        } else if (is_miss(&human.arena, shot_row, shot_col)) {
-            place_piece(&human.arena, shot_row, shot_col, MISS);
-            printf("THE ENGINE FIRED AT %s AND MISSED.\n", shot);
+        if (salvo_rules) {
+            /* Human fires one shot per ship afloat */
+            count = game_salvo_size(&game);
+            if (read_salvo(count, salvo) != 0) {
+                speculation_cancel(&speculation);
+                printf("\nNO MORE INPUT - EXITING GAME\n");
+                return 1;
+            }
+            printf("YOUR SALVO:\n");
+            game_fire_salvo(&game, salvo, count, reports);
+            if (game.winner >= 0) {
+                speculation_cancel(&speculation);
+                break;
+            }
+            
+            /* The engine fires the salvo prepared for its ships still afloat */
+            printf("\nPLEASE WAIT WHILE THE ENGINE MAKES ITS MOVE\n");
+            printf("THE ENGINE'S SALVO:\n");
+            count = speculation_commit(&speculation, &ai_engine, &rng_state, ai_player.ship_count, salvo);
+            if (count >= 0) {
+                game_fire_salvo(&game, salvo, count, reports);
+            } else {
+                game_engine_salvo(&game, &rng_state, reports);
+            }
+        } else {
+            /* Human fires */
+            cell = read_coordinate("ENTER COORDINATES TO FIRE AT (E.G., B5): ");
+            if (cell < 0) {
+                speculation_cancel(&speculation);
+                printf("\nNO MORE INPUT - EXITING GAME\n");
+                return 1;
+            }
+            game_fire(&game, cell, &report);
+            if (game.winner >= 0) {
+                speculation_cancel(&speculation);
+                break;
+            }
+            
+            /* AI fires, and learns from the result of its own shot */
+            printf("\nPLEASE WAIT WHILE THE ENGINE MAKES ITS MOVE\n");
+            if (speculation_commit(&speculation, &ai_engine, &rng_state, 0, salvo) > 0) {
+                game_fire(&game, salvo[0], &report);
+            } else {
+                game_engine_fire(&game, &rng_state, &report);
+            }
         }
         
-        /* Check if AI won */
-        if (is_navy_sunken(&human)) {
-            break;
+        if (game.winner < 0) {
+            printf("\n");
         }
-        
-        printf("\n");
     }
+    did_p1_win = game.winner == 0;
     
     /* Game end */
     printf("\n========================================\n");
@@ -193,7 +384,27 @@ int main(int argc, char* argv[]) {
     if (did_p1_win) {
         printf("CONGRATULATIONS %s, YOU HAVE WON THIS GAME OF BATTLESHIP!\n", human.name);
     } else {
-        printf("THE INTERMEDIATE AI ENGINE WON THIS GAME OF BATTLESHIP!\n");
+        printf("THE %s ENGINE WON THIS GAME OF BATTLESHIP!\n", ai_player.name);
+    }
+    
+    /* The engine remembers where this opponent put their ships */
+    if (learned_path != NULL) {
+        learned_prior_record(&human);
+        if (save_learned_prior(learned_path) != 0) {
+            printf("COULD NOT SAVE THE LEARNED MODEL TO %s\n", learned_path);
+        }
+    }
+    
+    /* Append the game record */
+    if (log_path != NULL) {
+        game_log_finish(&game_log, did_p1_win ? 0 : 1);
+        log_file = fopen(log_path, "ab");
+        if (log_file == NULL || game_log_write(log_file, &game_log) != 0) {
+            printf("COULD NOT WRITE THE GAME LOG TO %s\n", log_path);
+        }
+        if (log_file != NULL) {
+            fclose(log_file);
+        }
     }
     
     return 0;
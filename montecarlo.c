@@ -0,0 +1,71 @@
+/*
+ * montecarlo.c - Anytime Monte Carlo shot selection
+ * Cross-platform compatible
+ *
+ * With a move budget set, the engine spends it drawing whole fleets that
+ * agree with what it has observed (see sampler.c) and fires at the unfired
+ * square that holds a ship in the largest weighted share of them. Fleets
+ * are weighted by their chance under ai_place_fleet, the way the engine
+ * expects a fleet to be laid.
+ *
+ * Fleets are drawn in batches between reads of the monotonic clock. The
+ * totals after any batch give a usable answer, so the search simply stops
+ * at the deadline with the best square so far. If no fleet agrees with the
+ * observations the caller falls back to the engine's own heuristics. The search
+ * runs on the calling thread - the simulator already plays one game per
+ * core. Draws made, draws kept and time spent are totalled across threads
+ * for the samples/sec report.
+ */
+
+#include "battleship.h"
+
+static volatile long long total_samples = 0;
+static volatile long long total_kept = 0;
+static volatile long long total_ns = 0;
+
+/* Sample consistent fleets until the budget runs out - returns the best square, or -1 if none was found */
+int montecarlo_shot(const DensityState* ds, double budget, RandomStream* rng_state) {
+    double heat[MAX_BOARD_CELLS];
+    FleetSampler fs;
+    double started = monotonic_seconds();
+    long long samples, kept;
+    double best_heat;
+    int cell, best, ties;
+
+    fleet_sampler_init(&fs, ds);
+    if (fs.ships == 0) {
+        return -1;
+    }
+    fs.placer = 1;
+    samples = sample_heatmap(&fs, 0, started + budget, 1, random_next(rng_state), heat, &kept);
+
+    sync_fetch_add(&total_samples, samples);
+    sync_fetch_add(&total_kept, kept);
+    sync_fetch_add(&total_ns, (long long)((monotonic_seconds() - started) * 1e9));
+    if (kept == 0) {
+        return -1;
+    }
+
+    /* The unfired square most likely to hold a ship, ties broken at random */
+    best = -1;
+    best_heat = -1.0;
+    ties = 0;
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        if (mask_test(&ds->fired, cell)) continue;
+        if (heat[cell] > best_heat) {
+            best = cell;
+            best_heat = heat[cell];
+            ties = 1;
+        } else if (heat[cell] == best_heat && random_range(rng_state, 0, ties++) == 0) {
+            best = cell;
+        }
+    }
+    return best;
+}
+
+/* Samples drawn and kept, and seconds spent, by every thread so far */
+void montecarlo_totals(long long* samples, long long* kept, double* seconds) {
+    *samples = total_samples;
+    *kept = total_kept;
+    *seconds = (double)total_ns * 1e-9;
+}
@@ -0,0 +1,357 @@
+/*
+ * placement_kernel.c - Placement counting kernels for heatmap generation
+ * Cross-platform compatible
+ *
+ * Each kernel fills heat[cell] with the number of horizontal and vertical
+ * placements of every ship length in the fleet that cover the cell without
+ * touching a blocked square, multiplied by how many ships of that length
+ * remain. The scalar kernel walks runs of free squares and works for any
+ * board size. The SSE2 and AVX2 kernels expand every row into a 16-byte
+ * lane (one row per SSE2 register, two rows per AVX2 register), find
+ * placement starts with AND/shift and sum coverage with byte adds; they
+ * need boards of at most 16x16 and an x86 target. count_placements in ai_engine.c
+ * picks the best one at runtime.
+ */
+
+#include "battleship.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #if MAX_BOARD_SIZE <= 16
+        #define PLACEMENT_SIMD 1
+    #endif
+#endif
+
+#ifdef PLACEMENT_SIMD
+    #include <emmintrin.h>
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define TARGET_SSE2
+        #define TARGET_AVX2
+    #else
+        #define TARGET_SSE2 __attribute__((target("sse2")))
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+/* Scalar kernel - closed-form coverage of every run of free squares */
+void count_placements_scalar(const BoardMask* blocked, const int* fleet, int* heat) {
+    int vertical, line, pos, run_start, run_length, length, i, cell;
+    int low, high;
+    int step, stride;
+
+    for (i = 0; i < BOARD_CELLS; i++) {
+        heat[i] = 0;
+    }
+
+    for (vertical = 0; vertical < 2; vertical++) {
+        /* Walk rows (horizontal) or columns (vertical) as lines */
+        step = vertical ? BOARD_SIZE : 1;
+        stride = vertical ? 1 : BOARD_SIZE;
+
+        for (line = 0; line < BOARD_SIZE; line++) {
+            pos = 0;
+            while (pos < BOARD_SIZE) {
+                while (pos < BOARD_SIZE && mask_test(blocked, line * stride + pos * step)) {
+                    pos++;
+                }
+                run_start = pos;
+                while (pos < BOARD_SIZE && !mask_test(blocked, line * stride + pos * step)) {
+                    pos++;
+                }
+                run_length = pos - run_start;
+
+                for (length = 1; length <= MAX_SHIP_LENGTH && length <= run_length; length++) {
+                    if (fleet[length] == 0) continue;
+
+                    /* Square i of the run is covered by starts max(0,i-L+1)..min(i,n-L) */
+                    for (i = 0; i < run_length; i++) {
+                        low = i - length + 1 > 0 ? i - length + 1 : 0;
+                        high = i < run_length - length ? i : run_length - length;
+                        cell = line * stride + (run_start + i) * step;
+                        heat[cell] += fleet[length] * (high - low + 1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#ifdef PLACEMENT_SIMD
+
+/* Bits of one board row, bit c set for column c */
+static unsigned int row_bits(const BoardMask* m, int row) {
+    int start = row * BOARD_SIZE;
+    int word = start >> 6;
+    int offset = start & 63;
+    uint64_t bits = m->w[word] >> offset;
+
+    if (offset + BOARD_SIZE > 64 && word + 1 < MASK_WORDS) {
+        bits |= m->w[word + 1] << (64 - offset);
+    }
+    return (unsigned int)(bits & ((1u << BOARD_SIZE) - 1));
+}
+
+/* Expand a 16-bit row into 16 byte lanes holding 0 or 1 */
+TARGET_SSE2 static __m128i expand_row(unsigned int bits) {
+    const __m128i select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                         1, 2, 4, 8, 16, 32, 64, (char)128);
+    char lo = (char)(bits & 0xFF);
+    char hi = (char)((bits >> 8) & 0xFF);
+    __m128i v = _mm_setr_epi8(lo, lo, lo, lo, lo, lo, lo, lo,
+                              hi, hi, hi, hi, hi, hi, hi, hi);
+
+    v = _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+    return _mm_and_si128(v, _mm_set1_epi8(1));
+}
+
+/* Free squares of a row as bits, none outside the board */
+static unsigned int free_bits(const BoardMask* blocked, int row) {
+    if (row < 0 || row >= BOARD_SIZE) {
+        return 0;
+    }
+    return ~row_bits(blocked, row) & ((1u << BOARD_SIZE) - 1);
+}
+
+/* Free-square lanes of a row */
+TARGET_SSE2 static __m128i free_row(const BoardMask* blocked, int row) {
+    return expand_row(free_bits(blocked, row));
+}
+
+/* SSE2 kernel - one row per register */
+TARGET_SSE2 void count_placements_sse2(const BoardMask* blocked, const int* fleet, int* heat) {
+    /* Rows padded by MAX_SHIP_LENGTH on both sides so shifted reads stay in range */
+    __m128i free_lanes[MAX_BOARD_SIZE + 2 * MAX_SHIP_LENGTH];
+    __m128i starts[MAX_BOARD_SIZE + 2 * MAX_SHIP_LENGTH];
+    __m128i acc_lo[MAX_BOARD_SIZE], acc_hi[MAX_BOARD_SIZE];
+    __m128i zero = _mm_setzero_si128();
+    __m128i cover, h_start, shifted, weight, wide;
+    short lanes[16];
+    int row, length, k, col;
+
+    for (row = -MAX_SHIP_LENGTH; row < BOARD_SIZE + MAX_SHIP_LENGTH; row++) {
+        free_lanes[row + MAX_SHIP_LENGTH] = free_row(blocked, row);
+        starts[row + MAX_SHIP_LENGTH] = zero;
+    }
+    for (row = 0; row < BOARD_SIZE; row++) {
+        acc_lo[row] = zero;
+        acc_hi[row] = zero;
+    }
+
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        if (fleet[length] == 0) continue;
+        weight = _mm_set1_epi16((short)fleet[length]);
+
+        /* Vertical starts: free on this row and the next length-1 rows */
+        for (row = 0; row < BOARD_SIZE; row++) {
+            __m128i s = free_lanes[row + MAX_SHIP_LENGTH];
+            for (k = 1; k < length; k++) {
+                s = _mm_and_si128(s, free_lanes[row + k + MAX_SHIP_LENGTH]);
+            }
+            starts[row + MAX_SHIP_LENGTH] = s;
+        }
+
+        for (row = 0; row < BOARD_SIZE; row++) {
+            /* Vertical coverage from starts on the length-1 rows above */
+            cover = starts[row + MAX_SHIP_LENGTH];
+            for (k = 1; k < length; k++) {
+                cover = _mm_add_epi8(cover, starts[row - k + MAX_SHIP_LENGTH]);
+            }
+
+            /* Horizontal starts and coverage within the row */
+            h_start = free_lanes[row + MAX_SHIP_LENGTH];
+            shifted = h_start;
+            for (k = 1; k < length; k++) {
+                shifted = _mm_srli_si128(shifted, 1);
+                h_start = _mm_and_si128(h_start, shifted);
+            }
+            shifted = h_start;
+            cover = _mm_add_epi8(cover, h_start);
+            for (k = 1; k < length; k++) {
+                shifted = _mm_slli_si128(shifted, 1);
+                cover = _mm_add_epi8(cover, shifted);
+            }
+
+            /* Widen to 16 bits and weight by the ships of this length */
+            wide = _mm_mullo_epi16(_mm_unpacklo_epi8(cover, zero), weight);
+            acc_lo[row] = _mm_add_epi16(acc_lo[row], wide);
+            wide = _mm_mullo_epi16(_mm_unpackhi_epi8(cover, zero), weight);
+            acc_hi[row] = _mm_add_epi16(acc_hi[row], wide);
+        }
+    }
+
+    for (row = 0; row < BOARD_SIZE; row++) {
+        _mm_storeu_si128((__m128i*)lanes, acc_lo[row]);
+        _mm_storeu_si128((__m128i*)(lanes + 8), acc_hi[row]);
+        for (col = 0; col < BOARD_SIZE; col++) {
+            heat[row * BOARD_SIZE + col] = lanes[col];
+        }
+    }
+}
+
+/* Number of two-row pairs, plus padding pairs on each side */
+#define ROW_PAIRS ((BOARD_SIZE + 1) / 2)
+#define MAX_ROW_PAIRS ((MAX_BOARD_SIZE + 1) / 2)
+#define PAIR_PAD ((MAX_SHIP_LENGTH + 1) / 2 + 1)
+
+/* Rows (2j+d, 2j+1+d) from the even (2j, 2j+1) and odd (2j+1, 2j+2) pair arrays */
+TARGET_AVX2 static __m256i shifted_pair(const __m256i* even, const __m256i* odd, int j, int d) {
+    if (d % 2 == 0) {
+        return even[j + d / 2 + PAIR_PAD];
+    }
+    return odd[j + (d - 1) / 2 + PAIR_PAD];
+}
+
+/* Free-square lanes of rows (row, row+1), expanded without leaving AVX code */
+TARGET_AVX2 static __m256i free_pair(const BoardMask* blocked, int row) {
+    const __m256i select = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                            1, 2, 4, 8, 16, 32, 64, (char)128,
+                                            1, 2, 4, 8, 16, 32, 64, (char)128,
+                                            1, 2, 4, 8, 16, 32, 64, (char)128);
+    unsigned int a = free_bits(blocked, row);
+    unsigned int b = free_bits(blocked, row + 1);
+    char a_lo = (char)(a & 0xFF), a_hi = (char)((a >> 8) & 0xFF);
+    char b_lo = (char)(b & 0xFF), b_hi = (char)((b >> 8) & 0xFF);
+    __m256i v = _mm256_setr_epi8(a_lo, a_lo, a_lo, a_lo, a_lo, a_lo, a_lo, a_lo,
+                                 a_hi, a_hi, a_hi, a_hi, a_hi, a_hi, a_hi, a_hi,
+                                 b_lo, b_lo, b_lo, b_lo, b_lo, b_lo, b_lo, b_lo,
+                                 b_hi, b_hi, b_hi, b_hi, b_hi, b_hi, b_hi, b_hi);
+
+    v = _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+    return _mm256_and_si256(v, _mm256_set1_epi8(1));
+}
+
+/* Build the odd pairs (2j+1, 2j+2) from adjacent even pairs */
+TARGET_AVX2 static void build_odd_pairs(const __m256i* even, __m256i* odd) {
+    int j;
+    for (j = 0; j < ROW_PAIRS + 2 * PAIR_PAD - 1; j++) {
+        odd[j] = _mm256_permute2x128_si256(even[j], even[j + 1], 0x21);
+    }
+    odd[ROW_PAIRS + 2 * PAIR_PAD - 1] = _mm256_setzero_si256();
+}
+
+/* AVX2 kernel - two rows per register, byte shifts stay inside each row */
+TARGET_AVX2 void count_placements_avx2(const BoardMask* blocked, const int* fleet, int* heat) {
+    __m256i free_even[MAX_ROW_PAIRS + 2 * PAIR_PAD], free_odd[MAX_ROW_PAIRS + 2 * PAIR_PAD];
+    __m256i start_even[MAX_ROW_PAIRS + 2 * PAIR_PAD], start_odd[MAX_ROW_PAIRS + 2 * PAIR_PAD];
+    __m256i acc_lo[MAX_ROW_PAIRS], acc_hi[MAX_ROW_PAIRS];
+    __m256i zero = _mm256_setzero_si256();
+    __m256i cover, h_start, shifted, weight, wide, s;
+    short lanes[32];
+    int j, row, length, k, col;
+
+    for (j = -PAIR_PAD; j < ROW_PAIRS + PAIR_PAD; j++) {
+        free_even[j + PAIR_PAD] = free_pair(blocked, 2 * j);
+        start_even[j + PAIR_PAD] = zero;
+    }
+    build_odd_pairs(free_even, free_odd);
+    for (j = 0; j < ROW_PAIRS; j++) {
+        acc_lo[j] = zero;
+        acc_hi[j] = zero;
+    }
+
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        if (fleet[length] == 0) continue;
+        weight = _mm256_set1_epi16((short)fleet[length]);
+
+        /* Vertical starts for both rows of every pair */
+        for (j = 0; j < ROW_PAIRS; j++) {
+            s = free_even[j + PAIR_PAD];
+            for (k = 1; k < length; k++) {
+                s = _mm256_and_si256(s, shifted_pair(free_even, free_odd, j, k));
+            }
+            start_even[j + PAIR_PAD] = s;
+        }
+        build_odd_pairs(start_even, start_odd);
+
+        for (j = 0; j < ROW_PAIRS; j++) {
+            cover = start_even[j + PAIR_PAD];
+            for (k = 1; k < length; k++) {
+                cover = _mm256_add_epi8(cover, shifted_pair(start_even, start_odd, j, -k));
+            }
+
+            /* Byte shifts act on each 128-bit lane, i.e. on each row separately */
+            h_start = free_even[j + PAIR_PAD];
+            shifted = h_start;
+            for (k = 1; k < length; k++) {
+                shifted = _mm256_srli_si256(shifted, 1);
+                h_start = _mm256_and_si256(h_start, shifted);
+            }
+            shifted = h_start;
+            cover = _mm256_add_epi8(cover, h_start);
+            for (k = 1; k < length; k++) {
+                shifted = _mm256_slli_si256(shifted, 1);
+                cover = _mm256_add_epi8(cover, shifted);
+            }
+
+            wide = _mm256_mullo_epi16(_mm256_unpacklo_epi8(cover, zero), weight);
+            acc_lo[j] = _mm256_add_epi16(acc_lo[j], wide);
+            wide = _mm256_mullo_epi16(_mm256_unpackhi_epi8(cover, zero), weight);
+            acc_hi[j] = _mm256_add_epi16(acc_hi[j], wide);
+        }
+    }
+
+    /* acc_lo holds columns 0-7 and acc_hi columns 8-15 of both rows */
+    for (j = 0; j < ROW_PAIRS; j++) {
+        _mm256_storeu_si256((__m256i*)lanes, acc_lo[j]);
+        _mm256_storeu_si256((__m256i*)(lanes + 16), acc_hi[j]);
+        for (k = 0; k < 2; k++) {
+            row = 2 * j + k;
+            if (row >= BOARD_SIZE) break;
+            for (col = 0; col < BOARD_SIZE; col++) {
+                heat[row * BOARD_SIZE + col] = col < 8 ? lanes[k * 8 + col]
+                                                       : lanes[16 + k * 8 + col - 8];
+            }
+        }
+    }
+}
+
+/* Runtime CPU feature detection */
+int cpu_has_sse2(void) {
+    #ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[3] >> 26) & 1;
+    #else
+    return __builtin_cpu_supports("sse2");
+    #endif
+}
+
+int cpu_has_avx2(void) {
+    #ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    /* OSXSAVE and AVX, with the OS saving YMM state */
+    if (((regs[2] >> 27) & 1) == 0 || ((regs[2] >> 28) & 1) == 0) {
+        return 0;
+    }
+    if ((_xgetbv(0) & 6) != 6) {
+        return 0;
+    }
+    __cpuidex(regs, 7, 0);
+    return (regs[1] >> 5) & 1;
+    #else
+    return __builtin_cpu_supports("avx2");
+    #endif
+}
+
+#else
+
+/* No SIMD kernels on this target - fall back to the scalar kernel */
+void count_placements_sse2(const BoardMask* blocked, const int* fleet, int* heat) {
+    count_placements_scalar(blocked, fleet, heat);
+}
+
+void count_placements_avx2(const BoardMask* blocked, const int* fleet, int* heat) {
+    count_placements_scalar(blocked, fleet, heat);
+}
+
+int cpu_has_sse2(void) {
+    return 0;
+}
+
+int cpu_has_avx2(void) {
+    return 0;
+}
+
+#endif
@@ -5,49 +5,105 @@
 
 #include "battleship.h"
 
+/* Standard fleet, largest ship first - larger fleets repeat it */
+static const char* fleet_names[STANDARD_FLEET] = {
+    "AIRCRAFT CARRIER", "BATTLESHIP", "CRUISER", "SUBMARINE", "DESTROYER"
+};
+static const int fleet_lengths[STANDARD_FLEET] = { 5, 4, 3, 3, 2 };
+
+#ifdef DYNAMIC_BOARD
+int active_board_size = 10;
+int active_ship_count = STANDARD_FLEET;
+int active_mask_words = (100 + 63) / 64;
+#endif
+
+/* Length of the fleet's ship at the given index */
+int fleet_ship_length(int index) {
+    return fleet_lengths[index % STANDARD_FLEET];
+}
+
+/* Choose the board size and number of ships - returns 0, or -1 if this build cannot play it */
+int configure_board(int size, int ship_count) {
+    #ifdef DYNAMIC_BOARD
+    if (size < MIN_BOARD_SIZE || size > MAX_BOARD_SIZE || ship_count < 1 || ship_count > MAX_SHIPS) {
+        return -1;
+    }
+    active_board_size = size;
+    active_ship_count = ship_count;
+    active_mask_words = (size * size + 63) / 64;
+    #else
+    if (size != BOARD_SIZE || ship_count != NO_OF_SHIPS) {
+        return -1;
+    }
+    #endif
+    init_bitboards();
+    return 0;
+}
+
 /* Initialize a player */
 void init_player(Player* p, const char* name) {
     SAFE_STRCPY(p->name, name, MAX_NAME_LENGTH);
+    reset_fleet(p);
+}
+
+/* Clear the battlefield and take every ship off it */
+void reset_fleet(Player* p) {
+    int i;
+    
     init_battlefield(&p->arena);
     p->ship_count = NO_OF_SHIPS;
     
     /* Initialize all ships */
-    init_ship(&p->ships[0], "AIRCRAFT CARRIER", 5);
-    init_ship(&p->ships[1], "BATTLESHIP", 4);
-    init_ship(&p->ships[2], "CRUISER", 3);
-    init_ship(&p->ships[3], "SUBMARINE", 3);
-    init_ship(&p->ships[4], "DESTROYER", 2);
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        init_ship(&p->ships[i], fleet_names[i % STANDARD_FLEET], fleet_lengths[i % STANDARD_FLEET]);
+        if (i >= STANDARD_FLEET) {
+            SAFE_SPRINTF(p->ships[i].name, MAX_NAME_LENGTH, "%s %d",
+                fleet_names[i % STANDARD_FLEET], i / STANDARD_FLEET + 1);
+        }
+    }
+    for (i = 0; i < BOARD_CELLS; i++) {
+        p->ship_at[i] = -1;
+    }
+}
+
+/* Put a ship on the battlefield - coordinates must already be validated */
+void place_ship(Player* p, int ship_index, int roF, int roS, int coF, int coS) {
+    Ship* s = &p->ships[ship_index];
+    int i;
+    
+    store_ship_placement(s, roF, roS, coF, coS);
+    mask_or(&p->arena.ships, &s->remaining);
+    for (i = 0; i < s->position_count; i++) {
+        p->ship_at[s->cells[i]] = (signed char)ship_index;
+    }
 }
 
-/* Check if all ships are sunken */
+/* Check if all ships are sunken - every ship cell has been hit */
 int is_navy_sunken(Player* p) {
-    return p->ship_count == 0;
+    return mask_covers(&p->arena.hits, &p->arena.ships);
 }
 
-/* Manage ship hit - print message and update ship status */
-void manage_ship_hit(Player* p, char row, int col) {
-    int i, j;
-    int found = 0;
+/* Resolve a hit on a ship without console output - returns SHOT_HIT or SHOT_SUNK */
+int resolve_ship_hit(Player* p, int row, int col) {
+    int ship_index;
+    Ship* s;
     
     place_piece(&p->arena, row, col, HIT);
     
-    for (i = 0; i < NO_OF_SHIPS && !found; i++) {
-        if (i >= p->ship_count) continue;
-        
-        if (is_part_of_ship(&p->ships[i], row, col)) {
-            remove_ship_part(&p->ships[i], row, col);
-            
-            if (is_ship_sunken(&p->ships[i])) {
-                printf("YOU SANK A SHIP!\n");
-                /* Remove ship from array by shifting */
-                for (j = i; j < p->ship_count - 1; j++) {
-                    p->ships[j] = p->ships[j + 1];
-                }
-                p->ship_count--;
-            } else {
-                printf("YOU HIT A SHIP!\n");
-            }
-            found = 1;
-        }
+    ship_index = p->ship_at[cell_index(row, col)];
+    if (ship_index < 0) {
+        return SHOT_HIT;
+    }
+    
+    s = &p->ships[ship_index];
+    if (!is_part_of_ship(s, row, col)) {
+        return SHOT_HIT;
+    }
+    remove_ship_part(s, row, col);
+    
+    if (is_ship_sunken(s)) {
+        p->ship_count--;
+        return SHOT_SUNK;
     }
+    return SHOT_HIT;
 }
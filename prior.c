@@ -0,0 +1,125 @@
+/*
+ * prior.c - Placement prior for the hunting engines
+ * Cross-platform compatible
+ *
+ * A prior file records, for one board size and fleet, how many legal fleet
+ * layouts there are and how many of them cover each square. The fleet
+ * enumerator writes it; an engine loads it at startup and then hunts
+ * squares in proportion to how often a ship lies there, instead of
+ * uniformly. The counts are turned into small integer weights once, so a
+ * pick is a single pass over the candidate squares. The learned opponent
+ * model in learned.c hands its counts to the same weights.
+ */
+
+#include "battleship.h"
+
+static uint64_t prior_count[MAX_BOARD_CELLS];   /* layouts covering each square */
+static uint32_t prior_weight[MAX_BOARD_CELLS];
+static int prior_size = 0;                 /* board size of the loaded prior, 0 if none */
+
+/* Write a prior for the configured board and fleet - returns 0 on success */
+int write_placement_prior(FILE* file, uint64_t layouts, const uint64_t* occupancy) {
+    PriorHeader header;
+    uint8_t count[8];
+    int cell;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BSPR", 4);
+    header.version = PRIOR_VERSION;
+    header.board_size = (uint8_t)BOARD_SIZE;
+    header.ship_count = (uint8_t)NO_OF_SHIPS;
+    record_put_u64(header.layouts, layouts);
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        return -1;
+    }
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        record_put_u64(count, occupancy[cell]);
+        if (fwrite(count, sizeof(count), 1, file) != 1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Load a prior for the configured board and fleet - returns 0, or -1 if missing or for another board */
+int load_placement_prior(const char* path) {
+    PriorHeader header;
+    uint8_t count[8];
+    FILE* file = fopen(path, "rb");
+    int cell;
+
+    prior_size = 0;
+    if (file == NULL) {
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, "BSPR", 4) != 0 || header.version != PRIOR_VERSION ||
+        header.board_size != BOARD_SIZE || header.ship_count != NO_OF_SHIPS) {
+        fclose(file);
+        return -1;
+    }
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        if (fread(count, sizeof(count), 1, file) != 1) {
+            fclose(file);
+            return -1;
+        }
+        prior_count[cell] = record_u64(count);
+    }
+    fclose(file);
+    set_placement_prior(prior_count);
+    return 0;
+}
+
+/* Hunt by per-square counts for the configured board, from a file or learned */
+void set_placement_prior(const uint64_t* counts) {
+    uint64_t occupancy, most = 0;
+    int cell;
+
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        prior_count[cell] = counts[cell];
+        if (counts[cell] > most) most = counts[cell];
+    }
+
+    /* Every square keeps a weight of at least 1, so none is ruled out */
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        occupancy = most > 0 ? prior_count[cell] / (most / PRIOR_SCALE + 1) : 0;
+        prior_weight[cell] = (uint32_t)occupancy + 1;
+    }
+    prior_size = BOARD_SIZE;
+}
+
+/* Non-zero if a prior for the configured board is loaded */
+int placement_prior_loaded(void) {
+    return prior_size != 0 && prior_size == BOARD_SIZE;
+}
+
+/* Member of a non-empty set drawn in proportion to the prior - -1 without a prior */
+int placement_prior_pick(const BoardMask* set, RandomStream* rng_state) {
+    uint64_t word;
+    uint32_t total = 0, pick;
+    int i, cell;
+
+    if (!placement_prior_loaded()) {
+        return -1;
+    }
+    for (i = 0; i < MASK_WORDS; i++) {
+        for (word = set->w[i]; word != 0; word &= word - 1) {
+            total += prior_weight[i * 64 + lowest_bit(word)];
+        }
+    }
+    if (total == 0) {
+        return -1;
+    }
+
+    pick = random_below(rng_state, total);
+    for (i = 0; i < MASK_WORDS; i++) {
+        for (word = set->w[i]; word != 0; word &= word - 1) {
+            cell = i * 64 + lowest_bit(word);
+            if (pick < prior_weight[cell]) {
+                return cell;
+            }
+            pick -= prior_weight[cell];
+        }
+    }
+    return -1;
+}
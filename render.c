@@ -0,0 +1,212 @@
+/*
+ * render.c - Buffered frame renderer for the console game
+ * Cross-platform compatible
+ *
+ * A frame is both battlefields side by side plus status lines. It is built
+ * in the renderer's preallocated buffer and leaves with a single write, so
+ * slow serial lines and pipes see one burst per turn instead of a printf per
+ * cell. Quiet mode draws nothing. Diff mode draws the first frame in full,
+ * then only repaints the cells that changed and the status lines, using
+ * ANSI cursor addressing.
+ */
+
+#include "battleship.h"
+
+#define FRAME_GAP 4                   /* spaces between the two boards */
+#define FRAME_FIRST_BOARD_ROW 3       /* screen row of board row A, 1-based */
+
+/* Output being built - appends past the capacity are dropped */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} FrameText;
+
+static void append(FrameText* r, const char* text, size_t length) {
+    if (r->length + length > r->capacity) {
+        length = r->capacity - r->length;
+    }
+    memcpy(r->data + r->length, text, length);
+    r->length += length;
+}
+
+static void append_text(FrameText* r, const char* text) {
+    append(r, text, strlen(text));
+}
+
+static void append_char(FrameText* r, char c) {
+    append(r, &c, 1);
+}
+
+static void append_int(FrameText* r, int value) {
+    char digits[12];
+    int n = 0;
+
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0 && n < (int)sizeof(digits));
+    while (n > 0) {
+        append_char(r, digits[--n]);
+    }
+}
+
+static void append_spaces(FrameText* r, int count) {
+    while (count-- > 0) {
+        append_char(r, ' ');
+    }
+}
+
+/* Move the cursor to a 1-based screen position */
+static void append_cursor(FrameText* r, int row, int col) {
+    append_text(r, "\033[");
+    append_int(r, row);
+    append_char(r, ';');
+    append_int(r, col);
+    append_char(r, 'H');
+}
+
+/* Width of the longest row label - one letter up to row Z, two after */
+static int label_width(void) {
+    char label[MAX_COORD_LENGTH];
+    return format_row_label(BOARD_SIZE - 1, label);
+}
+
+/* Width of the column header line "  1 2 ... 10 " */
+static int board_width(void) {
+    int width = label_width() + 1;
+    int k;
+
+    for (k = 1; k <= BOARD_SIZE; k++) {
+        width += k >= 100 ? 4 : k >= 10 ? 3 : 2;
+    }
+    return width;
+}
+
+/* Piece drawn for a cell - ships are hidden on a cloaked board */
+static char shown_piece(const Battlefield* bf, int cell, int cloaked) {
+    char piece = cell_piece(bf, cell);
+    return (cloaked && piece == SHIP_PIECE) ? WATER : piece;
+}
+
+/* Append one board's line - line 0 is the column header, then rows A, B, ... */
+static void append_board_line(FrameText* r, const Battlefield* bf, int cloaked, int line) {
+    char label[MAX_COORD_LENGTH];
+    int width = label_width();
+    int k;
+
+    if (line == 0) {
+        append_spaces(r, width + 1);
+        for (k = 1; k <= BOARD_SIZE; k++) {
+            append_int(r, k);
+            append_char(r, ' ');
+        }
+        return;
+    }
+    append_spaces(r, width - format_row_label(line - 1, label));
+    append_text(r, label);
+    append_char(r, ' ');
+    for (k = 0; k < BOARD_SIZE; k++) {
+        append_char(r, shown_piece(bf, (line - 1) * BOARD_SIZE + k, cloaked));
+        append_char(r, ' ');
+    }
+}
+
+/* Start a renderer in RENDER_FULL, RENDER_QUIET or RENDER_DIFF mode */
+void init_renderer(Renderer* r, int mode) {
+    r->mode = mode;
+    r->drawn = 0;
+}
+
+/* Forget what is on screen - the next diff frame is drawn in full */
+void renderer_invalidate(Renderer* r) {
+    r->drawn = 0;
+}
+
+/* Build and write a frame with one board on each side and the status text below */
+void render_frame(Renderer* renderer, const RenderSide* left, const RenderSide* right, const char* status) {
+    FrameText text;
+    FrameText* r = &text;
+    const RenderSide* sides[2];
+    int width = board_width();
+    int margin = label_width() + 1;
+    int b, line, cell, column;
+    char piece;
+
+    if (renderer->mode == RENDER_QUIET) {
+        return;
+    }
+    sides[0] = left;
+    sides[1] = right;
+    text.data = renderer->buffer;
+    text.length = 0;
+    text.capacity = FRAME_BUFFER_SIZE;
+
+    if (renderer->mode == RENDER_DIFF && renderer->drawn) {
+        /* Repaint changed cells in place */
+        for (b = 0; b < 2; b++) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                piece = shown_piece(sides[b]->board, cell, sides[b]->cloaked);
+                if (piece != renderer->shown[b][cell]) {
+                    column = 1 + b * (width + FRAME_GAP) + margin + 2 * (cell % BOARD_SIZE);
+                    append_cursor(r, FRAME_FIRST_BOARD_ROW + cell / BOARD_SIZE, column);
+                    append_char(r, piece);
+                    renderer->shown[b][cell] = piece;
+                }
+            }
+        }
+        /* Status lines are rewritten, clearing whatever was printed below */
+        append_cursor(r, FRAME_FIRST_BOARD_ROW + BOARD_SIZE + 1, 1);
+        append_text(r, "\033[J");
+    } else {
+        if (renderer->mode == RENDER_DIFF) {
+            append_text(r, "\033[H\033[2J");
+        } else {
+            append_char(r, '\n');
+        }
+
+        append_text(r, sides[0]->title);
+        append_spaces(r, width + FRAME_GAP - (int)strlen(sides[0]->title));
+        append_text(r, sides[1]->title);
+        append_char(r, '\n');
+
+        for (line = 0; line <= BOARD_SIZE; line++) {
+            append_board_line(r, sides[0]->board, sides[0]->cloaked, line);
+            append_spaces(r, line == 0 ? FRAME_GAP : width + FRAME_GAP - margin - 2 * BOARD_SIZE);
+            append_board_line(r, sides[1]->board, sides[1]->cloaked, line);
+            append_char(r, '\n');
+        }
+        append_char(r, '\n');
+
+        for (b = 0; b < 2; b++) {
+            for (cell = 0; cell < BOARD_CELLS; cell++) {
+                renderer->shown[b][cell] = shown_piece(sides[b]->board, cell, sides[b]->cloaked);
+            }
+        }
+        renderer->drawn = 1;
+    }
+
+    if (status != NULL) {
+        append_text(r, status);
+    }
+
+    fwrite(text.data, 1, text.length, stdout);
+    fflush(stdout);
+}
+
+/* Format a single board as print_battlefield shows it - returns the length */
+size_t format_battlefield(const Battlefield* bf, int cloaked, char* out, size_t capacity) {
+    FrameText text;
+    FrameText* r = &text;
+    int line;
+
+    text.data = out;
+    text.length = 0;
+    text.capacity = capacity;
+    for (line = 0; line <= BOARD_SIZE; line++) {
+        append_char(r, '\n');
+        append_board_line(r, bf, cloaked, line);
+    }
+    append_text(r, "\n\n");
+    return text.length;
+}
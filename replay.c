@@ -0,0 +1,315 @@
+/*
+ * replay.c - Game log replay and analysis
+ * Cross-platform: Windows (MSVC/MinGW) and UNIVAC 1219 (GCC)
+ *
+ * Maps a game log (see gamelog.c) into memory and walks the records in
+ * place - each header says how many shot bytes follow, so the scan needs no
+ * parsing and no allocation per record. The summary reports wins, shots to
+ * win and hit rates per engine level plus where fleets were placed. With
+ * -g the chosen game is replayed shot by shot. Adding -p stops the replay
+ * after that many shots and shows, for each side, the chance of a ship on
+ * every square of the other board given what it had seen, estimated from
+ * consistent fleets drawn on every core (see sampler.c).
+ *
+ * Usage: battleship_replay [-g GAME [-p SHOTS] [-n SAMPLES] [-t THREADS]] FILE
+ *        GAME is the 0-based position of the record in the file
+ */
+
+#include "battleship.h"
+
+#define LEVEL_SLOTS 3           /* intermediate, advanced, human */
+#define DEFAULT_SAMPLES 1000000
+
+/* Statistics per kind of side */
+typedef struct {
+    long long sides;
+    long long wins;
+    long long win_shots;
+    long long shots;
+    long long hits;
+} LevelStats;
+
+static int level_slot(int level) {
+    if (level == GAME_LOG_HUMAN) return 2;
+    return level == AI_ADVANCED ? 1 : 0;
+}
+
+static const char* slot_name(int slot) {
+    static const char* names[LEVEL_SLOTS] = { "INTERMEDIATE", "ADVANCED", "HUMAN" };
+    return names[slot];
+}
+
+/* Rebuild a side's fleet from its record */
+static void restore_fleet(Player* p, const GameRecord* record, int side) {
+    int i, cell, length, vertical;
+    int row, col;
+
+    init_player(p, side == 0 ? "SIDE ONE" : "SIDE TWO");
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        cell = record->fleet[side][i][0];
+        length = record->fleet[side][i][1] & 0x7F;
+        vertical = (record->fleet[side][i][1] & 0x80) != 0;
+        row = cell_row(cell);
+        col = cell_col(cell);
+        if (length != p->ships[i].length) continue;
+        if (vertical) {
+            place_ship(p, i, row, row + length - 1, col, col);
+        } else {
+            place_ship(p, i, row, row, col, col + length - 1);
+        }
+    }
+}
+
+/* Print side's chances of a ship on each square of the other board, from what it has seen */
+static void print_posterior(int side, const DensityState* view, long long samples, int threads) {
+    static double heat[MAX_BOARD_CELLS];
+    char label[MAX_COORD_LENGTH];
+    FleetSampler fs;
+    long long drawn, kept;
+    double started, elapsed;
+    int i, k;
+
+    fleet_sampler_init(&fs, view);
+    if (fs.ships == 0) {
+        printf("\nSIDE %d HAS SUNK EVERY SHIP\n", side + 1);
+        return;
+    }
+    started = monotonic_seconds();
+    drawn = sample_heatmap(&fs, samples, 0.0, threads, (uint64_t)side, heat, &kept);
+    elapsed = monotonic_seconds() - started;
+
+    printf("\nSIDE %d VIEW - SHIP CHANCE %% PER SQUARE (%lld FLEETS, %.1f%% CONSISTENT, %.0f/SEC)\n    ",
+        side + 1, drawn, drawn > 0 ? 100.0 * (double)kept / (double)drawn : 0.0,
+        elapsed > 0.0 ? (double)drawn / elapsed : 0.0);
+    for (k = 1; k <= BOARD_SIZE; k++) printf("%5d", k);
+    printf("\n");
+    for (i = 0; i < BOARD_SIZE; i++) {
+        format_row_label(i, label);
+        printf("%-4s", label);
+        for (k = 0; k < BOARD_SIZE; k++) {
+            if (mask_test(&view->fired, i * BOARD_SIZE + k)) {
+                printf("%5s", mask_test(&view->misses, i * BOARD_SIZE + k) ? "." : "X");
+            } else {
+                printf("%5.1f", 100.0 * heat[i * BOARD_SIZE + k]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+/* Print one game shot by shot, then both final boards - or with stop >= 0, what
+   each side knew after stop shots */
+static void replay_game(const GameRecord* record, int stop, long long samples, int threads) {
+    const uint8_t* shots = (const uint8_t*)(record + 1);
+    int count = record_shot_count(record);
+    Player side[2];
+    Player* defender;
+    DensityState view[2];
+    char coord[MAX_COORD_LENGTH];
+    int k, turn, cell, result, length;
+    int row, col;
+
+    restore_fleet(&side[0], record, 0);
+    restore_fleet(&side[1], record, 1);
+    init_density_state(&view[0]);
+    init_density_state(&view[1]);
+
+    printf("SEED %llu  GAME %llu  %s VS %s\n",
+        (unsigned long long)record_u64(record->seed), (unsigned long long)record_u64(record->game),
+        slot_name(level_slot(record->levels[0])), slot_name(level_slot(record->levels[1])));
+
+    for (k = 0; k < count && k != stop; k++) {
+        turn = (record->first + k) & 1;
+        defender = &side[1 - turn];
+        cell = shots[k] & ~GAME_LOG_HIT;
+        if (cell == GAME_LOG_NO_SHOT) {
+            printf("%4d  SIDE %d  NO SHOT\n", k + 1, turn + 1);
+            continue;
+        }
+
+        row = cell_row(cell);
+        col = cell_col(cell);
+        decode_coord(cell, coord);
+        if (mask_test(&view[turn].fired, cell)) {
+            /* The log keeps a repeat as a non-hit - it must not settle as a miss over a known square */
+            printf("%4d  SIDE %d  %-4s REPEAT\n", k + 1, turn + 1, coord);
+            continue;
+        }
+        density_record_shot(&view[turn], cell);
+        if (shots[k] & GAME_LOG_HIT) {
+            length = defender->ship_at[cell] >= 0 ? defender->ships[defender->ship_at[cell]].length : 0;
+            result = resolve_ship_hit(defender, row, col);
+            density_record_hit(&view[turn], cell, result == SHOT_SUNK ? length : 0);
+            printf("%4d  SIDE %d  %-4s %s\n", k + 1, turn + 1, coord, result == SHOT_SUNK ? "SUNK" : "HIT");
+        } else {
+            if (is_miss(&defender->arena, row, col)) {
+                place_piece(&defender->arena, row, col, MISS);
+            }
+            printf("%4d  SIDE %d  %-4s MISS\n", k + 1, turn + 1, coord);
+        }
+    }
+
+    if (stop >= 0) {
+        density_settle(&view[0]);
+        density_settle(&view[1]);
+        print_posterior(0, &view[0], samples, threads);
+        print_posterior(1, &view[1], samples, threads);
+        return;
+    }
+
+    if (record->winner == GAME_LOG_NO_WINNER) {
+        printf("\nNO WINNER\n");
+    } else {
+        printf("\nSIDE %d WON\n", record->winner + 1);
+    }
+    printf("\nSIDE 1 BATTLEFIELD:\n");
+    print_battlefield(&side[0].arena, 0);
+    print_divider();
+    printf("SIDE 2 BATTLEFIELD:\n");
+    print_battlefield(&side[1].arena, 0);
+}
+
+int main(int argc, char* argv[]) {
+    static long long occupancy[MAX_BOARD_CELLS];
+    char label[MAX_COORD_LENGTH];
+    LevelStats stats[LEVEL_SLOTS];
+    const char* path = NULL;
+    const unsigned char* base;
+    const GameRecord* record;
+    const uint8_t* shots;
+    size_t size, offset = 0;
+    long long wanted = -1, records = 0, fleets = 0, undecided = 0;
+    long long samples = DEFAULT_SAMPLES;
+    int stop = -1, threads = cpu_count();
+    double started, elapsed;
+    int i, k, side, count, slot, length, step, cell, winner;
+    LevelStats* ls;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            wanted = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            stop = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            samples = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || (stop >= 0 && wanted < 0)) {
+        fprintf(stderr, "USAGE: %s [-g GAME [-p SHOTS] [-n SAMPLES] [-t THREADS]] FILE\n", argv[0]);
+        return 1;
+    }
+    if (samples < 1) samples = 1;
+
+    base = (const unsigned char*)map_file(path, &size);
+    if (base == NULL) {
+        fprintf(stderr, "CANNOT MAP %s\n", path);
+        return 1;
+    }
+
+    /* A DYNAMIC_BOARD build plays the board size the log was written for */
+    record = (const GameRecord*)base;
+    if (size >= sizeof(GameRecord) && memcmp(record->magic, "BSGL", 4) == 0) {
+        configure_board(record->board_size, record->ship_count);
+    }
+    init_bitboards();
+    memset(stats, 0, sizeof(stats));
+
+    started = monotonic_seconds();
+    while (offset < size) {
+        record = (const GameRecord*)(base + offset);
+        if (!record_is_valid(record, size - offset)) {
+            break;
+        }
+        shots = (const uint8_t*)(record + 1);
+        count = record_shot_count(record);
+
+        if (records == wanted) {
+            replay_game(record, stop, samples, threads);
+            unmap_file(base, size);
+            return 0;
+        }
+
+        winner = record->winner;
+        if (winner == GAME_LOG_NO_WINNER) {
+            undecided++;
+        }
+        for (side = 0; side < 2; side++) {
+            ls = &stats[level_slot(record->levels[side])];
+            ls->sides++;
+            /* Shots alternate, so the side's shots are every other byte */
+            for (k = (side - record->first) & 1; k < count; k += 2) {
+                ls->shots += (shots[k] & ~GAME_LOG_HIT) != GAME_LOG_NO_SHOT;
+                ls->hits += shots[k] >> 7;
+            }
+            if (winner == side) {
+                ls->wins++;
+                ls->win_shots += (count + (record->first == side)) / 2;
+            }
+
+            for (i = 0; i < NO_OF_SHIPS; i++) {
+                length = record->fleet[side][i][1] & 0x7F;
+                step = (record->fleet[side][i][1] & 0x80) ? BOARD_SIZE : 1;
+                cell = record->fleet[side][i][0];
+                for (k = 0; k < length && cell + k * step < BOARD_CELLS; k++) {
+                    occupancy[cell + k * step]++;
+                }
+            }
+            fleets++;
+        }
+        records++;
+        offset += sizeof(GameRecord) + (size_t)count;
+    }
+    elapsed = monotonic_seconds() - started;
+    unmap_file(base, size);
+
+    if (wanted >= 0) {
+        fprintf(stderr, "GAME %lld NOT FOUND - THE LOG HOLDS %lld GAMES\n", wanted, records);
+        return 1;
+    }
+
+    printf("========================================\n");
+    printf("   BATTLESHIP - GAME LOG ANALYSIS\n");
+    printf("   PLATFORM: %s\n", PLATFORM_NAME);
+    printf("========================================\n");
+    printf("FILE:            %s\n", path);
+    printf("GAMES:           %lld\n", records);
+    printf("UNDECIDED:       %lld\n", undecided);
+    printf("BYTES:           %llu (%.1f PER GAME)\n", (unsigned long long)size,
+        records > 0 ? (double)offset / (double)records : 0.0);
+    if (offset < size) {
+        printf("UNREADABLE TAIL: %llu BYTES\n", (unsigned long long)(size - offset));
+    }
+    printf("SCAN:            %.3f S (%.0f GAMES/SEC)\n", elapsed,
+        elapsed > 0.0 ? (double)records / elapsed : 0.0);
+
+    printf("\n%-14s %10s %8s %12s %9s\n", "SIDE", "GAMES", "WINS", "SHOTS/WIN", "HIT RATE");
+    for (slot = 0; slot < LEVEL_SLOTS; slot++) {
+        ls = &stats[slot];
+        if (ls->sides == 0) continue;
+        printf("%-14s %10lld %7.2f%% %12.2f %8.2f%%\n", slot_name(slot), ls->sides,
+            100.0 * (double)ls->wins / (double)ls->sides,
+            ls->wins > 0 ? (double)ls->win_shots / (double)ls->wins : 0.0,
+            ls->shots > 0 ? 100.0 * (double)ls->hits / (double)ls->shots : 0.0);
+    }
+
+    printf("\nSHIP OCCUPANCY %% PER SQUARE:\n    ");
+    for (k = 1; k <= BOARD_SIZE; k++) printf("%5d", k);
+    printf("\n");
+    for (i = 0; i < BOARD_SIZE; i++) {
+        format_row_label(i, label);
+        printf("%-4s", label);
+        for (k = 0; k < BOARD_SIZE; k++) {
+            printf("%5.1f", fleets > 0 ? 100.0 * (double)occupancy[i * BOARD_SIZE + k] / (double)fleets : 0.0);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
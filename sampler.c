@@ -0,0 +1,613 @@
+/*
+ * sampler.c - Fleets consistent with the engine's observations
+ * Cross-platform compatible
+ *
+ * sample_fleet builds one whole fleet of the ships still afloat that
+ * avoids every miss and sunk ship and covers every open hit. While hits are
+ * left uncovered it takes the lowest of them and places a ship across it,
+ * choosing among the placements of every length left that cover it and
+ * keep a square unhit - a ship hit on every square would have been sunk.
+ * Once every hit is covered the rest of the fleet goes down longest first
+ * on the free starts.
+ *
+ * A placement is only a candidate if the ships left can still be laid
+ * after it, so no draw ever reaches a dead end. Most positions prove that
+ * cheaply: the start counts leave room for every ship left however the
+ * others are laid (see roomy). Where they do not, each placement is checked
+ * by a backtracking search for one way to finish the fleet, and the
+ * placements it cannot finish are dropped before the choice is made.
+ *
+ * Each choice is uniform among its candidates, so a fleet is drawn with
+ * probability the product of 1 / candidates along its path. The fleet's
+ * weight is that product inverted, divided by the orders in which ships of
+ * one length could have been laid, and weighted sums over drawn fleets
+ * estimate sums over all consistent fleets equally. Every draw is kept
+ * unless no fleet at all agrees with the observations.
+ *
+ * sample_heatmap spreads draws over threads, each with its own random
+ * stream of the seed, and adds up per-square weights into the probability
+ * that a ship covers each square. Workers claim batches of
+ * SAMPLE_BATCH draws and read the monotonic clock between batches, so a
+ * run stops at a sample count, a deadline or whichever comes first.
+ */
+
+#include "battleship.h"
+
+/* Draws between clock reads and claims of work */
+#define SAMPLE_BATCH 16
+
+/* Placements covering one square at most - every length, both ways, every offset */
+#define MAX_COVERING (2 * MAX_SHIP_LENGTH * MAX_SHIP_LENGTH)
+
+/* Worker threads at most */
+#define SAMPLER_MAX_THREADS 64
+
+/* Ships of one length whose orders placer_chance tells apart */
+#define PLACER_ORDERS 2
+
+/* One worker's share of a sample_heatmap run */
+typedef struct {
+    const FleetSampler* fs;
+    volatile long long* next_batch;
+    long long batches;          /* batches in the run, 0 for no limit */
+    double deadline;            /* monotonic seconds, 0 for none */
+    RandomStream rng;
+    long long drawn;
+    long long kept;
+    double total;               /* sum of kept weights */
+    double heat[MAX_BOARD_CELLS];
+} HeatWorker;
+
+/* Squares a placement covers */
+static void line_mask(BoardMask* m, int vertical, int length, int cell) {
+    int step = vertical ? BOARD_SIZE : 1;
+    int k;
+
+    mask_clear(m);
+    for (k = 0; k < length; k++, cell += step) {
+        mask_set(m, cell);
+    }
+}
+
+/* Squares still open to a ship beside those placed */
+static void open_cells(const FleetSampler* fs, const BoardMask* placed, BoardMask* free_cells) {
+    BoardMask ships;
+    int i;
+
+    for (i = 0; i < MASK_WORDS; i++) {
+        ships.w[i] = fs->sunk.w[i] | placed->w[i];
+    }
+    clear_of_ships(&ships, free_cells);
+    for (i = 0; i < MASK_WORDS; i++) {
+        free_cells->w[i] &= ~fs->misses.w[i];
+    }
+}
+
+/* Placements of length b that one ship of length a rules out at most - those
+   crossing its squares or the squares at either side of it */
+static int blocked_starts(int a, int b) {
+    int across = (a + b + 1) + (a + 2) * b;     /* ship along a row */
+    int down = a * (b + 2) + 3 * (a + b - 1);   /* ship down a column */
+
+    return across > down ? across : down;
+}
+
+/* Starts on the free squares of each length left, 0 for the others */
+static void start_counts(const BoardMask* free_cells, const int* left, int* counts) {
+    BoardMask horizontal, vertical;
+    int length;
+
+    counts[0] = 0;
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        counts[length] = 0;
+        if (left[length] == 0) continue;
+        free_starts(free_cells, length, &horizontal, &vertical);
+        counts[length] = mask_popcount(&horizontal) + mask_popcount(&vertical);
+    }
+}
+
+/*
+ * Non-zero if the ships in left can be laid longest first however each is
+ * placed, after one more ship of length first (0 for none) - every ship
+ * still has a start once each laid before it has ruled out all it can
+ */
+static int roomy(const int* counts, const int* left, int first) {
+    int length, other, need;
+
+    for (length = MAX_SHIP_LENGTH; length >= 1; length--) {
+        if (left[length] == 0) continue;
+        need = 1 + (left[length] - 1) * blocked_starts(length, length);
+        if (first > 0) {
+            need += blocked_starts(first, length);
+        }
+        for (other = length + 1; other <= MAX_SHIP_LENGTH; other++) {
+            need += left[other] * blocked_starts(other, length);
+        }
+        if (counts[length] < need) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Non-zero if the ships in left can be laid beside those placed so that they
+ * cover every uncovered square - a backtracking search that stops at the
+ * first way found. Ships of one length go in increasing order of placement
+ * from floor, as any other order lays the same fleet.
+ */
+static int completable(const FleetSampler* fs, const BoardMask* placed, const BoardMask* uncovered,
+    int* left, int floor) {
+    BoardMask free_cells, horizontal, vertical, line, after, rest;
+    int counts[MAX_SHIP_LENGTH + 1];
+    int hit, col, length, way, k, start, i, found;
+
+    open_cells(fs, placed, &free_cells);
+
+    if (mask_is_empty(uncovered)) {
+        start_counts(&free_cells, left, counts);
+        for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+            if (left[length] > 0 && counts[length] == 0) return 0;
+        }
+        if (roomy(counts, left, 0)) return 1;
+
+        for (length = MAX_SHIP_LENGTH; left[length] == 0; length--) {
+        }
+        free_starts(&free_cells, length, &horizontal, &vertical);
+        left[length]--;
+        found = 0;
+        for (way = 0; way < 2 && !found; way++) {
+            rest = way ? vertical : horizontal;
+            while (!found && !mask_is_empty(&rest)) {
+                start = mask_select(&rest, 0);
+                mask_reset(&rest, start);
+                if (way * BOARD_CELLS + start < floor) continue;
+                line_mask(&line, way, length, start);
+                for (i = 0; i < MASK_WORDS; i++) {
+                    after.w[i] = placed->w[i] | line.w[i];
+                }
+                found = completable(fs, &after, uncovered, left,
+                    left[length] > 0 ? way * BOARD_CELLS + start + 1 : 0);
+            }
+        }
+        left[length]++;
+        return found;
+    }
+
+    /* A ship of some length left must lie across the lowest uncovered hit and keep a square unhit */
+    hit = mask_select(uncovered, 0);
+    col = hit % BOARD_SIZE;
+    for (length = MAX_SHIP_LENGTH; length >= 1; length--) {
+        if (left[length] == 0) continue;
+        free_starts(&free_cells, length, &horizontal, &vertical);
+        for (way = 0; way < 2; way++) {
+            for (k = 0; k < length; k++) {
+                start = way ? hit - k * BOARD_SIZE : hit - k;
+                if (start < 0 || (!way && k > col)) break;
+                if (!mask_test(way ? &vertical : &horizontal, start)) continue;
+
+                line_mask(&line, way, length, start);
+                if (mask_covers(&fs->open_hits, &line)) continue;
+                for (i = 0; i < MASK_WORDS; i++) {
+                    rest.w[i] = uncovered->w[i] & ~line.w[i];
+                    after.w[i] = placed->w[i] | line.w[i];
+                }
+                left[length]--;
+                found = completable(fs, &after, &rest, left, 0);
+                left[length]++;
+                if (found) return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Prepare to draw fleets consistent with ds */
+void fleet_sampler_init(FleetSampler* fs, const DensityState* ds) {
+    BoardMask placed, free_cells, horizontal, vertical;
+    int left[MAX_SHIP_LENGTH + 1];
+    int counts[MAX_SHIP_LENGTH + 1];
+    int length, i;
+
+    fs->misses = ds->misses;
+    fs->sunk = ds->sunk;
+    fs->open_hits = ds->open_hits;
+    if (ds->pending_cell >= 0) {
+        mask_set(&fs->misses, ds->pending_cell);
+    }
+    fs->ships = 0;
+    fs->afloat[0] = 0;
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        fs->afloat[length] = ds->afloat[length];
+        fs->ships += ds->afloat[length];
+    }
+
+    /* ai_place_fleet's slots for the ships afloat, in fleet order after the sunk ones */
+    fs->placer = 0;
+    fs->slots = 0;
+    for (length = 0; length <= MAX_SHIP_LENGTH; length++) {
+        left[length] = 0;
+    }
+    for (i = 0; i < NO_OF_SHIPS; i++) {
+        length = fleet_ship_length(i);
+        if (left[length] < fs->afloat[length]) {
+            left[length]++;
+            fs->order[fs->slots++] = length;
+        }
+    }
+    fs->first_starts = 0;
+    if (fs->slots > 0) {
+        legal_starts(&fs->sunk, fs->order[0], &horizontal, &vertical);
+        fs->first_starts = mask_popcount(&horizontal) + mask_popcount(&vertical);
+    }
+
+    mask_clear(&placed);
+    for (length = 0; length <= MAX_SHIP_LENGTH; length++) {
+        left[length] = fs->afloat[length];
+    }
+    fs->consistent = completable(fs, &placed, &fs->open_hits, left, 0);
+    fs->roomy = 0;
+    if (fs->consistent && mask_is_empty(&fs->open_hits)) {
+        open_cells(fs, &placed, &free_cells);
+        start_counts(&free_cells, left, counts);
+        fs->roomy = roomy(counts, left, 0);
+    }
+}
+
+/* Record a placement in the fleet */
+static void add_ship(SampledFleet* f, BoardMask* placed, const BoardMask* line, int vertical, int length, int cell) {
+    int i;
+
+    f->start[f->ships] = cell;
+    f->length[f->ships] = length;
+    f->vertical[f->ships] = vertical;
+    f->ships++;
+    for (i = 0; i < MASK_WORDS; i++) {
+        placed->w[i] |= line->w[i];
+    }
+}
+
+/* Place a ship across the lowest uncovered hit - returns 0 if no placement can be finished */
+static int cover_hit(const FleetSampler* fs, SampledFleet* f, BoardMask* placed, BoardMask* uncovered,
+    int* left, RandomStream* rng_state) {
+    int lengths[MAX_COVERING], starts[MAX_COVERING], verticals[MAX_COVERING];
+    BoardMask horizontals[MAX_SHIP_LENGTH + 1], verticals_free[MAX_SHIP_LENGTH + 1];
+    BoardMask free_cells, line, after, rest;
+    int counts[MAX_SHIP_LENGTH + 1];
+    int room[MAX_SHIP_LENGTH + 1];
+    int hit = mask_select(uncovered, 0);
+    int col = hit % BOARD_SIZE;
+    int count = 0;
+    int length, way, k, start, i, pick, found;
+
+    open_cells(fs, placed, &free_cells);
+    counts[0] = 0;
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        counts[length] = 0;
+        if (left[length] == 0) continue;
+        free_starts(&free_cells, length, &horizontals[length], &verticals_free[length]);
+        counts[length] = mask_popcount(&horizontals[length]) + mask_popcount(&verticals_free[length]);
+    }
+
+    /* With this the last hit, one room test settles every placement of a length */
+    for (length = 1; length <= MAX_SHIP_LENGTH; length++) {
+        room[length] = 0;
+        if (left[length] == 0 || mask_popcount(uncovered) > 1) continue;
+        left[length]--;
+        room[length] = roomy(counts, left, length);
+        left[length]++;
+    }
+
+    for (length = MAX_SHIP_LENGTH; length >= 1; length--) {
+        if (left[length] == 0) continue;
+        for (way = 0; way < 2; way++) {
+            for (k = 0; k < length; k++) {
+                start = way ? hit - k * BOARD_SIZE : hit - k;
+                if (start < 0 || (!way && k > col)) break;
+                if (!mask_test(way ? &verticals_free[length] : &horizontals[length], start)) continue;
+
+                /* A ship with every square hit would have been reported sunk */
+                line_mask(&line, way, length, start);
+                if (mask_covers(&fs->open_hits, &line)) continue;
+
+                if (!room[length]) {
+                    for (i = 0; i < MASK_WORDS; i++) {
+                        rest.w[i] = uncovered->w[i] & ~line.w[i];
+                        after.w[i] = placed->w[i] | line.w[i];
+                    }
+                    left[length]--;
+                    found = completable(fs, &after, &rest, left, 0);
+                    left[length]++;
+                    if (!found) continue;
+                }
+                lengths[count] = length;
+                starts[count] = start;
+                verticals[count] = way;
+                count++;
+            }
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    pick = (int)random_below(rng_state, (uint32_t)count);
+    line_mask(&line, verticals[pick], lengths[pick], starts[pick]);
+    add_ship(f, placed, &line, verticals[pick], lengths[pick], starts[pick]);
+    for (i = 0; i < MASK_WORDS; i++) {
+        uncovered->w[i] &= ~line.w[i];
+    }
+    left[lengths[pick]]--;
+    f->weight *= (double)count;
+    return 1;
+}
+
+/* Clear the starts after which the ships in left could not all be laid */
+static void drop_dead_starts(const FleetSampler* fs, const BoardMask* placed, int* left, int vertical, int length,
+    BoardMask* starts) {
+    BoardMask scan = *starts;
+    BoardMask line, after, none;
+    int cell, i;
+
+    mask_clear(&none);
+    while (!mask_is_empty(&scan)) {
+        cell = mask_select(&scan, 0);
+        mask_reset(&scan, cell);
+        line_mask(&line, vertical, length, cell);
+        for (i = 0; i < MASK_WORDS; i++) {
+            after.w[i] = placed->w[i] | line.w[i];
+        }
+        if (!completable(fs, &after, &none, left, 0)) {
+            mask_reset(starts, cell);
+        }
+    }
+}
+
+/* One weigh_by_placer pass - the legal start count of each slot is kept for the
+   ships laid before it, which every order of a length ends up sharing */
+typedef struct {
+    const SampledFleet* f;
+    const FleetSampler* fs;
+    uint64_t laid[MAX_SHIPS];   /* ships of f laid before the slot's count was taken */
+    int counts[MAX_SHIPS];      /* -1 until taken */
+} PlacerWalk;
+
+/*
+ * Chance ai_place_fleet lays the ships of f from slot on, each uniformly
+ * among its legal starts beside ships, summed over which ship of a length
+ * takes which slot - while more than PLACER_ORDERS ships of the slot's length
+ * are waiting, the first of them stands for them all
+ */
+static double placer_chance(PlacerWalk* walk, int slot, const BoardMask* ships, uint64_t used) {
+    const SampledFleet* f = walk->f;
+    BoardMask horizontal, vertical, line, after;
+    int length;
+    int waiting = 0;
+    int i, k;
+    double sum = 0.0;
+
+    if (slot == walk->fs->slots) {
+        return 1.0;
+    }
+    length = walk->fs->order[slot];
+    if (walk->counts[slot] < 0 || walk->laid[slot] != used) {
+        legal_starts(ships, length, &horizontal, &vertical);
+        walk->counts[slot] = mask_popcount(&horizontal) + mask_popcount(&vertical);
+        walk->laid[slot] = used;
+    }
+    if (walk->counts[slot] == 0) {
+        return 0.0;
+    }
+
+    for (i = 0; i < f->ships; i++) {
+        if (f->length[i] == length && !(used >> i & 1)) waiting++;
+    }
+    for (i = 0; i < f->ships; i++) {
+        if (f->length[i] != length || (used >> i & 1)) continue;
+        line_mask(&line, f->vertical[i], length, f->start[i]);
+        for (k = 0; k < MASK_WORDS; k++) {
+            after.w[k] = ships->w[k] | line.w[k];
+        }
+        sum += placer_chance(walk, slot + 1, &after, used | (uint64_t)1 << i);
+        if (waiting > PLACER_ORDERS) {
+            sum *= (double)waiting;
+            break;
+        }
+    }
+    return sum / (double)walk->counts[slot];
+}
+
+/* Scale the weight of f by the chance ai_place_fleet lays it */
+static void weigh_by_placer(const FleetSampler* fs, SampledFleet* f) {
+    PlacerWalk walk;
+    int slot;
+
+    walk.f = f;
+    walk.fs = fs;
+    for (slot = 0; slot < fs->slots; slot++) {
+        walk.counts[slot] = -1;
+    }
+    if (fs->slots > 0) {
+        /* The first slot only sees the sunk ships, the same for every fleet */
+        walk.counts[0] = fs->first_starts;
+        walk.laid[0] = 0;
+    }
+    f->weight *= placer_chance(&walk, 0, &fs->sunk, 0);
+}
+
+/* Draw one fleet consistent with the observations - returns 0 only if there is none */
+int sample_fleet(const FleetSampler* fs, SampledFleet* f, RandomStream* rng_state) {
+    BoardMask placed, uncovered, free_cells, horizontal, vertical, line;
+    int left[MAX_SHIP_LENGTH + 1];
+    int counts[MAX_SHIP_LENGTH + 1];
+    int length, group, i, cell, horizontal_count, total, pick, way, spacious;
+
+    f->ships = 0;
+    f->weight = 1.0;
+    if (!fs->consistent) {
+        return 0;
+    }
+    mask_clear(&placed);
+    uncovered = fs->open_hits;
+    for (length = 0; length <= MAX_SHIP_LENGTH; length++) {
+        left[length] = fs->afloat[length];
+    }
+
+    /* Every open hit first, each by a ship laid across it */
+    spacious = fs->roomy;
+    if (!mask_is_empty(&uncovered)) {
+        while (!mask_is_empty(&uncovered)) {
+            if (!cover_hit(fs, f, &placed, &uncovered, left, rng_state)) {
+                return 0;
+            }
+        }
+        open_cells(fs, &placed, &free_cells);
+        start_counts(&free_cells, left, counts);
+        spacious = roomy(counts, left, 0);
+    }
+
+    /* Then the ships left, longest first - unless there is room for any order, each
+       start is kept only if the rest can follow it */
+    for (length = MAX_SHIP_LENGTH; length >= 1; length--) {
+        group = left[length];
+        while (left[length] > 0) {
+            open_cells(fs, &placed, &free_cells);
+            free_starts(&free_cells, length, &horizontal, &vertical);
+            left[length]--;
+            if (!spacious) {
+                start_counts(&free_cells, left, counts);
+                spacious = roomy(counts, left, length);
+                if (!spacious) {
+                    drop_dead_starts(fs, &placed, left, 0, length, &horizontal);
+                    drop_dead_starts(fs, &placed, left, 1, length, &vertical);
+                }
+            }
+            horizontal_count = mask_popcount(&horizontal);
+            total = horizontal_count + mask_popcount(&vertical);
+            if (total == 0) {
+                return 0;
+            }
+
+            pick = (int)random_below(rng_state, (uint32_t)total);
+            way = pick >= horizontal_count;
+            cell = way ? mask_select(&vertical, pick - horizontal_count) : mask_select(&horizontal, pick);
+            line_mask(&line, way, length, cell);
+            add_ship(f, &placed, &line, way, length, cell);
+            f->weight *= (double)total;
+        }
+
+        /* Each fleet is reached once per order of its ships of this length */
+        for (i = 2; i <= group; i++) {
+            f->weight /= (double)i;
+        }
+    }
+
+    f->cells = placed;
+    for (i = f->ships; i < MAX_SHIPS; i++) {
+        f->start[i] = -1;
+    }
+    if (fs->placer) {
+        weigh_by_placer(fs, f);
+    }
+    return 1;
+}
+
+/* Worker - draw batches until the count or the deadline is reached */
+static void heat_worker(void* arg) {
+    HeatWorker* w = (HeatWorker*)arg;
+    SampledFleet fleet;
+    uint64_t word;
+    int k, i;
+
+    for (;;) {
+        if (w->batches > 0 && sync_fetch_add(w->next_batch, 1) >= w->batches) {
+            break;
+        }
+        for (k = 0; k < SAMPLE_BATCH; k++) {
+            w->drawn++;
+            if (!sample_fleet(w->fs, &fleet, &w->rng)) {
+                continue;
+            }
+            w->kept++;
+            w->total += fleet.weight;
+            for (i = 0; i < MASK_WORDS; i++) {
+                for (word = fleet.cells.w[i]; word != 0; word &= word - 1) {
+                    w->heat[i * 64 + lowest_bit(word)] += fleet.weight;
+                }
+            }
+        }
+        if (w->deadline > 0.0 && monotonic_seconds() >= w->deadline) {
+            break;
+        }
+    }
+}
+
+/*
+ * Draw fleets on threads workers until samples are drawn (0 for no limit) or
+ * the monotonic deadline passes (0 for none) - heat gets the chance each
+ * square holds a ship. Returns the draws made; kept, if not NULL, gets those
+ * that yielded a fleet - all of them, or none if no fleet is consistent.
+ */
+long long sample_heatmap(const FleetSampler* fs, long long samples, double deadline, int threads,
+    uint64_t seed, double* heat, long long* kept) {
+    ThreadHandle handles[SAMPLER_MAX_THREADS];
+    int started[SAMPLER_MAX_THREADS];
+    volatile long long next_batch = 0;
+    HeatWorker* workers;
+    long long drawn = 0, kept_total = 0;
+    double total = 0.0;
+    int t, cell;
+
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        heat[cell] = 0.0;
+    }
+    if (kept != NULL) {
+        *kept = 0;
+    }
+    if (!fs->consistent) {
+        return 0;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > SAMPLER_MAX_THREADS) threads = SAMPLER_MAX_THREADS;
+    workers = (HeatWorker*)calloc((size_t)threads, sizeof(HeatWorker));
+    if (workers == NULL) {
+        return 0;
+    }
+
+    for (t = 0; t < threads; t++) {
+        workers[t].fs = fs;
+        workers[t].next_batch = &next_batch;
+        workers[t].batches = samples > 0 ? (samples + SAMPLE_BATCH - 1) / SAMPLE_BATCH : 0;
+        workers[t].deadline = deadline;
+        random_stream(&workers[t].rng, seed, (uint64_t)t);
+    }
+
+    /* The calling thread is worker 0 */
+    for (t = 1; t < threads; t++) {
+        started[t] = thread_start(&handles[t], heat_worker, &workers[t]) == 0;
+    }
+    heat_worker(&workers[0]);
+    for (t = 1; t < threads; t++) {
+        if (started[t]) {
+            thread_join(&handles[t]);
+        }
+    }
+
+    for (t = 0; t < threads; t++) {
+        drawn += workers[t].drawn;
+        kept_total += workers[t].kept;
+        total += workers[t].total;
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            heat[cell] += workers[t].heat[cell];
+        }
+    }
+    free(workers);
+
+    if (total > 0.0) {
+        for (cell = 0; cell < BOARD_CELLS; cell++) {
+            heat[cell] /= total;
+        }
+    }
+    if (kept != NULL) {
+        *kept = kept_total;
+    }
+    return drawn;
+}
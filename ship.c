@@ -10,61 +10,39 @@ void init_ship(Ship* s, const char* name, int length) {
     SAFE_STRCPY(s->name, name, MAX_NAME_LENGTH);
     s->length = length;
     s->position_count = 0;
+    mask_clear(&s->remaining);
 }
 
 /* Store ship placement coordinates */
-void store_ship_placement(Ship* s, char roF, char roS, int coF, int coS) {
+void store_ship_placement(Ship* s, int roF, int roS, int coF, int coS) {
     int i;
-    char coord[MAX_COORD_LENGTH];
+    int cell = cell_index(roF, coF);
+    int step = (roF == roS) ? 1 : BOARD_SIZE;
+    int count = (roF == roS) ? coS - coF + 1 : roS - roF + 1;
     
     s->position_count = 0;
+    mask_clear(&s->remaining);
     
-    if (roF == roS) {
-        /* Horizontal placement */
-        for (i = coF; i <= coS; i++) {
-            SAFE_SPRINTF(coord, MAX_COORD_LENGTH, "%c%d", roF, i);
-            SAFE_STRCPY(s->positions[s->position_count], coord, MAX_COORD_LENGTH);
-            s->position_count++;
-        }
-    } else {
-        /* Vertical placement */
-        for (i = roF; i <= roS; i++) {
-            SAFE_SPRINTF(coord, MAX_COORD_LENGTH, "%c%d", (char)i, coF);
-            SAFE_STRCPY(s->positions[s->position_count], coord, MAX_COORD_LENGTH);
-            s->position_count++;
-        }
+    for (i = 0; i < count && i < MAX_SHIP_LENGTH; i++) {
+        s->cells[i] = cell + i * step;
+        mask_set(&s->remaining, s->cells[i]);
+        s->position_count++;
     }
 }
 
-/* Check if coordinate is part of this ship */
-int is_part_of_ship(Ship* s, char row, int col) {
-    int i;
-    char coord[MAX_COORD_LENGTH];
-    SAFE_SPRINTF(coord, MAX_COORD_LENGTH, "%c%d", row, col);
-    
-    for (i = 0; i < s->position_count; i++) {
-        if (strcmp(s->positions[i], coord) == 0) {
-            return 1;
-        }
+/* Check if coordinate is an unhit part of this ship */
+int is_part_of_ship(Ship* s, int row, int col) {
+    if (!on_board(row, col)) {
+        return 0;
     }
-    return 0;
+    return mask_test(&s->remaining, cell_index(row, col));
 }
 
 /* Remove a ship part when hit */
-void remove_ship_part(Ship* s, char row, int col) {
-    int i, j;
-    char coord[MAX_COORD_LENGTH];
-    SAFE_SPRINTF(coord, MAX_COORD_LENGTH, "%c%d", row, col);
-    
-    for (i = 0; i < s->position_count; i++) {
-        if (strcmp(s->positions[i], coord) == 0) {
-            /* Shift remaining positions */
-            for (j = i; j < s->position_count - 1; j++) {
-                SAFE_STRCPY(s->positions[j], s->positions[j + 1], MAX_COORD_LENGTH);
-            }
-            s->position_count--;
-            break;
-        }
+void remove_ship_part(Ship* s, int row, int col) {
+    if (is_part_of_ship(s, row, col)) {
+        mask_reset(&s->remaining, cell_index(row, col));
+        s->position_count--;
     }
 }
 
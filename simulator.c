@@ -0,0 +1,455 @@
+/*
+ * simulator.c - Headless AI-vs-AI self-play simulator
+ * Cross-platform: Windows (MSVC/MinGW) and UNIVAC 1219 (GCC)
+ *
+ * Pits two AI engines against each other on fleets placed with
+ * ai_place_fleet and plays batches of games on a pool of worker
+ * threads. Game N draws from random stream N of the seed, so every game is
+ * reproducible by its index whatever the thread count. Every worker has its
+ * own statistics block; the totals are merged and reported only after all
+ * workers have finished. With -l every game is also written to a binary
+ * game log, see gamelog.c.
+ *
+ * Neither engine sees the other's board, so a game is two independent
+ * races to clear a fleet, and the first engine wins when it needs no more
+ * shots than the second. With -x an Intermediate match is played that way
+ * on the batch engine, each race drawing from its own stream, see batch.c.
+ *
+ * Usage: battleship_sim [-g GAMES] [-t THREADS] [-s SEED] [-a LEVEL] [-b LEVEL] [-l FILE]
+ *                       [-P FILE] [-e MS] [-m MS] [-c MB] [-x] [-B SIZE] [-F SHIPS]
+ *        LEVEL is INTERMEDIATE or ADVANCED for the first (-a) and second (-b) engine
+ *        -P loads a placement prior that guides the Intermediate engine's hunting
+ *        -e lets both engines solve endgames exactly, MS milliseconds a move, see endgame.c
+ *        -m lets both engines sample consistent fleets, MS milliseconds a move, see montecarlo.c
+ *        -c shares MB megabytes of Advanced heatmaps between all games, see heatcache.c
+ *        -x plays Intermediate against Intermediate on the batch engine
+ *        -B and -F pick the board size and fleet in a DYNAMIC_BOARD build
+ */
+
+#include "battleship.h"
+#include <math.h>
+
+#define DEFAULT_GAMES 1000000
+#define GAMES_PER_CHUNK 256
+#define MAX_THREADS 256
+#define MAX_GAME_SHOTS (2 * MAX_POSITIONS)
+
+/* Work shared by all workers */
+typedef struct {
+    volatile long long next_game;
+    long long total_games;
+    uint64_t seed;
+    int levels[2];
+    double endgame_budget;      /* seconds per endgame move, 0 to play without the solver */
+    double move_budget;         /* seconds per move for Monte Carlo sampling, 0 to play without it */
+    int batched;                /* play on the batch engine */
+    GameLogSink* log_sink;      /* NULL when not logging */
+} SimBatch;
+
+/* Per-thread state and statistics */
+typedef struct {
+    SimBatch* batch;
+    GameLogBuffer* log_buffer;
+    long long games;
+    long long first_player_wins;
+    long long stalled_games;
+    long long shot_sum;
+    long long shot_square_sum;
+    int min_shots;
+    int max_shots;
+    long long histogram[MAX_GAME_SHOTS + 1];
+} SimWorker;
+
+/* Play one game, returns winning side (0 or 1) or -1 if the game stalled */
+static int play_game(const SimBatch* batch, RandomStream* rng_state, int* winner_shots, GameLog* log) {
+    Player side[2];
+    IntermediateAI engine[2];
+    GameObserver recorder;
+    Game game;
+    ShotReport report;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        init_player(&side[i], i == 0 ? "AI ONE" : "AI TWO");
+        if (ai_place_fleet(&side[i], rng_state) != VALID_COORD) {
+            return -1;
+        }
+        if (batch->levels[i] == AI_ADVANCED) {
+            init_advanced_ai(&engine[i]);
+        } else {
+            init_intermediate_ai(&engine[i]);
+        }
+        set_endgame_budget(&engine[i], batch->endgame_budget);
+        set_move_budget(&engine[i], batch->move_budget);
+        if (log != NULL) {
+            game_log_fleet(log, i, &side[i]);
+        }
+    }
+
+    recorder.shot = game_log_observe;
+    recorder.game_over = NULL;
+    recorder.context = log;
+    game_begin(&game, &side[0], &engine[0], &side[1], &engine[1], 0, log != NULL ? &recorder : NULL);
+    while (game.winner < 0 && game.shots[0] + game.shots[1] < 2 * MAX_GAME_SHOTS) {
+        game_engine_fire(&game, rng_state, &report);
+    }
+
+    if (game.winner >= 0) {
+        *winner_shots = game.shots[game.winner];
+    }
+    return game.winner;
+}
+
+/* Count one decided or stalled game */
+static void tally_game(SimWorker* w, int winner, int shots) {
+    w->games++;
+    if (winner < 0) {
+        w->stalled_games++;
+        return;
+    }
+    if (winner == 0) {
+        w->first_player_wins++;
+    }
+    w->shot_sum += shots;
+    w->shot_square_sum += (long long)shots * shots;
+    if (shots < w->min_shots) w->min_shots = shots;
+    if (shots > w->max_shots) w->max_shots = shots;
+    w->histogram[shots]++;
+}
+
+/* Worker loop - claims chunks of games until the batch is exhausted */
+static void sim_worker(void* arg) {
+    SimWorker* w = (SimWorker*)arg;
+    RandomStream rng;
+    GameLog log;
+    GameLog* game_log = w->log_buffer != NULL ? &log : NULL;
+    long long start, end, g;
+    int winner, shots;
+
+    while (1) {
+        start = sync_fetch_add(&w->batch->next_game, GAMES_PER_CHUNK);
+        if (start >= w->batch->total_games) {
+            break;
+        }
+        end = start + GAMES_PER_CHUNK;
+        if (end > w->batch->total_games) {
+            end = w->batch->total_games;
+        }
+
+        for (g = start; g < end; g++) {
+            shots = 0;
+            random_stream(&rng, w->batch->seed, (uint64_t)g);
+            if (game_log != NULL) {
+                game_log_begin(game_log, w->batch->seed, (uint64_t)g, 0,
+                    w->batch->levels[0], w->batch->levels[1]);
+            }
+            winner = play_game(w->batch, &rng, &shots, game_log);
+            if (game_log != NULL) {
+                game_log_finish(game_log, winner);
+                game_log_buffer_add(w->log_buffer, game_log);
+            }
+            tally_game(w, winner, shots);
+        }
+    }
+}
+
+/* Batch worker loop - both races of every game in a chunk run side by side on the batch engine */
+static void sim_batch_worker(void* arg) {
+    SimWorker* w = (SimWorker*)arg;
+    GameBatch games;
+    Player fleet;
+    RandomStream rng;
+    int race_shots[2 * GAMES_PER_CHUNK];
+    long long start, end, race;
+    int k, first, second;
+
+    if (batch_init(&games, 2 * GAMES_PER_CHUNK) != 0) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        return;
+    }
+    init_player(&fleet, "BATCH");
+
+    while (1) {
+        start = sync_fetch_add(&w->batch->next_game, GAMES_PER_CHUNK);
+        if (start >= w->batch->total_games) {
+            break;
+        }
+        end = start + GAMES_PER_CHUNK;
+        if (end > w->batch->total_games) {
+            end = w->batch->total_games;
+        }
+
+        /* Race 2N + K is engine K firing at the fleet of game N's other side */
+        for (race = 2 * start; race < 2 * end; race++) {
+            random_stream(&rng, w->batch->seed, (uint64_t)race);
+            race_shots[race - 2 * start] = -1;
+            if (ai_place_fleet(&fleet, &rng) == VALID_COORD) {
+                batch_add(&games, &fleet, race, &rng);
+            }
+        }
+        while (games.live > 0) {
+            batch_step(&games);
+            for (k = 0; k < games.done; k++) {
+                race_shots[games.done_game[k] - 2 * start] = games.done_shots[k];
+            }
+        }
+
+        /* The first engine fires first, so it wins ties */
+        for (k = 0; k < 2 * (int)(end - start); k += 2) {
+            first = race_shots[k];
+            second = race_shots[k + 1];
+            if (first < 0 || second < 0) {
+                tally_game(w, -1, 0);
+            } else if (first <= second) {
+                tally_game(w, 0, first);
+            } else {
+                tally_game(w, 1, second);
+            }
+        }
+    }
+    batch_free(&games);
+}
+
+/* Parse an engine level name */
+static int parse_level(const char* name) {
+    return (name[0] == 'a' || name[0] == 'A') ? AI_ADVANCED : AI_INTERMEDIATE;
+}
+
+static const char* level_name(int level) {
+    return level == AI_ADVANCED ? "ADVANCED" : "INTERMEDIATE";
+}
+
+/* Smallest shot count whose cumulative share reaches the given fraction */
+static int histogram_percentile(const long long* histogram, long long total, double fraction) {
+    long long seen = 0;
+    int i;
+
+    for (i = 0; i <= MAX_GAME_SHOTS; i++) {
+        seen += histogram[i];
+        if (total > 0 && (double)seen >= fraction * (double)total) {
+            return i;
+        }
+    }
+    return MAX_GAME_SHOTS;
+}
+
+int main(int argc, char* argv[]) {
+    SimBatch batch;
+    SimWorker* workers;
+    ThreadHandle threads[MAX_THREADS];
+    SimWorker total;
+    GameLogSink log_sink;
+    ThreadFunc worker;
+    const char* log_path = NULL;
+    const char* prior_path = NULL;
+    long long decided;
+    uint64_t seed = 0;
+    int seeded = 0;
+    int thread_count = cpu_count();
+    int board_option = BOARD_SIZE, ships_option = NO_OF_SHIPS;
+    long long games = DEFAULT_GAMES;
+    double started, elapsed, mean, variance, sampling;
+    long long samples, kept;
+    double cache_mb = 0.0;
+    HeatCacheStats cache;
+    int i, j;
+
+    batch.levels[0] = AI_INTERMEDIATE;
+    batch.levels[1] = AI_INTERMEDIATE;
+    batch.endgame_budget = 0.0;
+    batch.move_budget = 0.0;
+    batch.batched = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            games = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = (uint64_t)strtoull(argv[++i], NULL, 10);
+            seeded = 1;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            batch.levels[0] = parse_level(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batch.levels[1] = parse_level(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            prior_path = argv[++i];
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            batch.endgame_budget = atof(argv[++i]) / 1000.0;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            batch.move_budget = atof(argv[++i]) / 1000.0;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache_mb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-x") == 0) {
+            batch.batched = 1;
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            board_option = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            ships_option = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "USAGE: %s [-g GAMES] [-t THREADS] [-s SEED] [-a LEVEL] [-b LEVEL] [-l FILE]"
+                " [-P FILE] [-e MS] [-m MS] [-c MB] [-x] [-B SIZE] [-F SHIPS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (configure_board(board_option, ships_option) != 0) {
+        fprintf(stderr, "THIS BUILD CANNOT PLAY %dX%d WITH %d SHIPS\n", board_option, board_option, ships_option);
+        return 1;
+    }
+    if (log_path != NULL && !game_log_supported()) {
+        fprintf(stderr, "GAME LOGS HOLD BOARDS OF AT MOST %d SQUARES\n", GAME_LOG_NO_SHOT);
+        return 1;
+    }
+    if (prior_path != NULL && load_placement_prior(prior_path) != 0) {
+        fprintf(stderr, "CANNOT LOAD A PRIOR FOR THIS BOARD FROM %s\n", prior_path);
+        return 1;
+    }
+    if (cache_mb > 0.0 && heat_cache_init((size_t)(cache_mb * 1048576.0)) != 0) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        return 1;
+    }
+    if (batch.batched && (batch.levels[0] != AI_INTERMEDIATE || batch.levels[1] != AI_INTERMEDIATE ||
+        log_path != NULL || batch.endgame_budget > 0.0 || batch.move_budget > 0.0)) {
+        fprintf(stderr, "THE BATCH ENGINE PLAYS INTERMEDIATE AGAINST INTERMEDIATE, WITHOUT -l, -e OR -m\n");
+        return 1;
+    }
+    if (games < 1) games = 1;
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+    if (!seeded) {
+        seed = time_seed();
+    }
+
+    workers = (SimWorker*)calloc((size_t)thread_count, sizeof(SimWorker));
+    if (workers == NULL) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        return 1;
+    }
+
+    /* Placement tables and kernel must be ready before workers share them */
+    init_bitboards();
+    select_placement_kernel(KERNEL_AUTO);
+
+    batch.next_game = 0;
+    batch.total_games = games;
+    batch.seed = seed;
+    batch.log_sink = NULL;
+    if (log_path != NULL) {
+        log_sink.file = fopen(log_path, "wb");
+        log_sink.lock = 0;
+        if (log_sink.file == NULL) {
+            fprintf(stderr, "CANNOT OPEN %s\n", log_path);
+            free(workers);
+            return 1;
+        }
+        batch.log_sink = &log_sink;
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        workers[i].batch = &batch;
+        workers[i].min_shots = MAX_GAME_SHOTS;
+        if (batch.log_sink != NULL) {
+            workers[i].log_buffer = (GameLogBuffer*)calloc(1, sizeof(GameLogBuffer));
+            if (workers[i].log_buffer == NULL) {
+                fprintf(stderr, "OUT OF MEMORY\n");
+                return 1;
+            }
+            workers[i].log_buffer->sink = batch.log_sink;
+        }
+    }
+
+    worker = batch.batched ? sim_batch_worker : sim_worker;
+    started = monotonic_seconds();
+    for (i = 1; i < thread_count; i++) {
+        if (thread_start(&threads[i], worker, &workers[i]) != 0) {
+            fprintf(stderr, "FAILED TO START WORKER %d\n", i);
+            threads[i].impl = NULL;
+        }
+    }
+    worker(&workers[0]);
+    for (i = 1; i < thread_count; i++) {
+        thread_join(&threads[i]);
+    }
+    elapsed = monotonic_seconds() - started;
+
+    /* Merge per-thread statistics */
+    memset(&total, 0, sizeof(total));
+    total.min_shots = MAX_GAME_SHOTS;
+    for (i = 0; i < thread_count; i++) {
+        total.games += workers[i].games;
+        total.first_player_wins += workers[i].first_player_wins;
+        total.stalled_games += workers[i].stalled_games;
+        total.shot_sum += workers[i].shot_sum;
+        total.shot_square_sum += workers[i].shot_square_sum;
+        if (workers[i].min_shots < total.min_shots) total.min_shots = workers[i].min_shots;
+        if (workers[i].max_shots > total.max_shots) total.max_shots = workers[i].max_shots;
+        for (j = 0; j <= MAX_GAME_SHOTS; j++) {
+            total.histogram[j] += workers[i].histogram[j];
+        }
+        if (workers[i].log_buffer != NULL) {
+            game_log_buffer_flush(workers[i].log_buffer);
+            free(workers[i].log_buffer);
+        }
+    }
+    free(workers);
+    if (batch.log_sink != NULL) {
+        fclose(log_sink.file);
+    }
+
+    decided = total.games - total.stalled_games;
+    mean = decided > 0 ? (double)total.shot_sum / (double)decided : 0.0;
+    variance = decided > 0 ? (double)total.shot_square_sum / (double)decided - mean * mean : 0.0;
+    if (variance < 0.0) variance = 0.0;
+
+    printf("========================================\n");
+    printf("   BATTLESHIP - HEADLESS SIMULATOR\n");
+    printf("   PLATFORM: %s\n", PLATFORM_NAME);
+    printf("========================================\n");
+    printf("SEED:            %llu\n", (unsigned long long)seed);
+    printf("THREADS:         %d\n", thread_count);
+    printf("ENGINES:         %s VS %s%s\n", level_name(batch.levels[0]), level_name(batch.levels[1]),
+        batch.batched ? " (BATCH ENGINE)" : "");
+    printf("BOARD:           %dX%d, %d SHIPS\n", BOARD_SIZE, BOARD_SIZE, NO_OF_SHIPS);
+    printf("PLACEMENT PRIOR: %s\n", prior_path != NULL ? prior_path : "NONE");
+    if (batch.endgame_budget > 0.0) {
+        printf("ENDGAME SOLVER:  %.1f MS A MOVE\n", batch.endgame_budget * 1000.0);
+    } else {
+        printf("ENDGAME SOLVER:  OFF\n");
+    }
+    if (batch.move_budget > 0.0) {
+        montecarlo_totals(&samples, &kept, &sampling);
+        printf("MONTE CARLO:     %.2f MS A MOVE, %lld SAMPLES (%.1f%% CONSISTENT)\n", batch.move_budget * 1000.0,
+            samples, samples > 0 ? 100.0 * (double)kept / (double)samples : 0.0);
+        printf("SAMPLES/SEC:     %.0f PER THREAD, %.0f IN ALL\n",
+            sampling > 0.0 ? (double)samples / sampling : 0.0, elapsed > 0.0 ? (double)samples / elapsed : 0.0);
+    } else {
+        printf("MONTE CARLO:     OFF\n");
+    }
+    if (heat_cache_enabled()) {
+        heat_cache_stats(&cache);
+        printf("HEATMAP CACHE:   %.1f MB, %lld SLOTS, %lld STORED, %lld EVICTED\n",
+            (double)cache.bytes / 1048576.0, cache.slots, cache.stores, cache.evictions);
+        printf("CACHE HITS:      %.2f%% OF %lld LOOKUPS\n",
+            cache.lookups > 0 ? 100.0 * (double)cache.hits / (double)cache.lookups : 0.0, cache.lookups);
+    } else {
+        printf("HEATMAP CACHE:   OFF\n");
+    }
+    printf("GAMES:           %lld\n", total.games);
+    printf("STALLED GAMES:   %lld\n", total.stalled_games);
+    printf("ELAPSED:         %.3f S\n", elapsed);
+    printf("GAMES/SEC:       %.0f\n", elapsed > 0.0 ? (double)total.games / elapsed : 0.0);
+    printf("FIRST ENGINE WIN:%.2f%%\n",
+        decided > 0 ? 100.0 * (double)total.first_player_wins / (double)decided : 0.0);
+    printf("SHOTS TO WIN:    MEAN %.2f  STDDEV %.2f  MIN %d  MAX %d\n",
+        mean, sqrt(variance), decided > 0 ? total.min_shots : 0, total.max_shots);
+    printf("PERCENTILES:     P50 %d  P90 %d  P99 %d\n",
+        histogram_percentile(total.histogram, decided, 0.50),
+        histogram_percentile(total.histogram, decided, 0.90),
+        histogram_percentile(total.histogram, decided, 0.99));
+
+    heat_cache_free();
+    return 0;
+}
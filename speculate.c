@@ -0,0 +1,100 @@
+/*
+ * speculate.c - Speculative engine moves during the human's turn
+ * Cross-platform compatible
+ *
+ * While the console waits for the human to type a shot, a worker thread
+ * works out the engine's reply. It thinks on a snapshot of the engine and
+ * the random stream taken before it starts, so the live engine is never
+ * shared: the main thread only reads the worker's results after joining it.
+ *
+ * The engine's next shot depends on what it has seen of the human's fleet,
+ * not on where the human fires, so a miss, a hit and a sunk ship that
+ * leaves the engine afloat all lead to the same reply. Under salvo rules a
+ * sunk ship also takes one shot off the engine's salvo, so one move is
+ * prepared for each salvo size the human's shots can leave, largest first.
+ * The matching move is committed by copying its engine state over the live
+ * one. If the game ends instead, the speculation is cancelled: the worker
+ * stops before its next move and is joined.
+ */
+
+#include "battleship.h"
+
+/* Worker - prepare the move for each outcome until done or cancelled */
+static void speculation_worker(void* arg) {
+    Speculation* s = (Speculation*)arg;
+    SpeculativeMove* move;
+    char coord[MAX_COORD_LENGTH];
+    int k;
+
+    for (k = 0; k < s->outcomes; k++) {
+        if (sync_fetch_add(&s->cancelled, 0) != 0) {
+            break;
+        }
+        move = &s->moves[k];
+        move->engine = s->engine;
+        move->rng = s->rng;
+        if (s->salvo) {
+            move->count = ai_choose_salvo(&move->engine, s->shots - k, move->cells, &move->rng);
+        } else {
+            ai_fire_salvo(&move->engine, coord, &move->rng);
+            move->cells[0] = move->engine.previous_shot;
+            move->count = 1;
+        }
+        sync_fetch_add(&s->prepared, 1);
+    }
+}
+
+/* Start preparing the engine's next move - shots is its salvo size now, 0 for one shot a turn;
+   fewest is the smallest salvo the human's turn can leave it */
+void speculation_start(Speculation* s, const IntermediateAI* ai, const RandomStream* rng_state,
+    int shots, int fewest) {
+    s->engine = *ai;
+    s->rng = *rng_state;
+    s->salvo = shots > 0;
+    s->shots = shots;
+    s->outcomes = 1;
+    if (s->salvo) {
+        if (fewest < 1) fewest = 1;
+        s->outcomes = shots - fewest + 1;
+        if (s->outcomes > SPECULATION_OUTCOMES) s->outcomes = SPECULATION_OUTCOMES;
+        if (s->outcomes < 1) s->outcomes = 1;
+    }
+    s->cancelled = 0;
+    s->prepared = 0;
+    s->running = thread_start(&s->thread, speculation_worker, s) == 0;
+}
+
+/* Stop the worker and discard what it prepared */
+void speculation_cancel(Speculation* s) {
+    if (s->running) {
+        sync_fetch_add(&s->cancelled, 1);
+        thread_join(&s->thread);
+        s->running = 0;
+    }
+    s->prepared = 0;
+}
+
+/* Take the prepared move for a salvo of shots (0 for one shot) into the live engine and stream -
+   returns the squares to fire at, or -1 if that move was not prepared */
+int speculation_commit(Speculation* s, IntermediateAI* ai, RandomStream* rng_state, int shots, int* cells) {
+    SpeculativeMove* move;
+    int k = s->salvo ? s->shots - shots : 0;
+    int i;
+
+    if (s->running) {
+        thread_join(&s->thread);
+        s->running = 0;
+    }
+    if ((shots > 0) != s->salvo || k < 0 || k >= s->prepared) {
+        return -1;
+    }
+
+    move = &s->moves[k];
+    *ai = move->engine;
+    *rng_state = move->rng;
+    for (i = 0; i < move->count; i++) {
+        cells[i] = move->cells[i];
+    }
+    s->prepared = 0;
+    return move->count;
+}
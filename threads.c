@@ -0,0 +1,227 @@
+/*
+ * threads.c - Threading, atomics, timing and file mapping for the headless tools
+ * Cross-platform: Win32 threads on Windows, POSIX threads elsewhere
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "battleship.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+/* Start routine trampoline data */
+typedef struct {
+    ThreadFunc fn;
+    void* arg;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+} ThreadImpl;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID param) {
+    ThreadImpl* impl = (ThreadImpl*)param;
+    impl->fn(impl->arg);
+    return 0;
+}
+#else
+static void* thread_entry(void* param) {
+    ThreadImpl* impl = (ThreadImpl*)param;
+    impl->fn(impl->arg);
+    return NULL;
+}
+#endif
+
+/* Start a thread running fn(arg) - returns 0 on success */
+int thread_start(ThreadHandle* t, ThreadFunc fn, void* arg) {
+    ThreadImpl* impl = (ThreadImpl*)malloc(sizeof(ThreadImpl));
+
+    t->impl = NULL;
+    if (impl == NULL) {
+        return -1;
+    }
+    impl->fn = fn;
+    impl->arg = arg;
+
+    #ifdef _WIN32
+    impl->handle = CreateThread(NULL, 0, thread_entry, impl, 0, NULL);
+    if (impl->handle == NULL) {
+        free(impl);
+        return -1;
+    }
+    #else
+    if (pthread_create(&impl->handle, NULL, thread_entry, impl) != 0) {
+        free(impl);
+        return -1;
+    }
+    #endif
+
+    t->impl = impl;
+    return 0;
+}
+
+/* Wait for a thread to finish and release it */
+void thread_join(ThreadHandle* t) {
+    ThreadImpl* impl = (ThreadImpl*)t->impl;
+
+    if (impl == NULL) {
+        return;
+    }
+
+    #ifdef _WIN32
+    WaitForSingleObject(impl->handle, INFINITE);
+    CloseHandle(impl->handle);
+    #else
+    pthread_join(impl->handle, NULL);
+    #endif
+
+    free(impl);
+    t->impl = NULL;
+}
+
+/* Number of online processors, at least 1 */
+int cpu_count(void) {
+    #ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+    #else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+    #endif
+}
+
+/* Monotonic wall clock in seconds */
+double monotonic_seconds(void) {
+    #ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+    #endif
+}
+
+/* Atomically add delta to *value and return the previous value */
+long long sync_fetch_add(volatile long long* value, long long delta) {
+    #ifdef _MSC_VER
+    return InterlockedExchangeAdd64(value, delta);
+    #else
+    return __sync_fetch_and_add(value, delta);
+    #endif
+}
+
+/* Atomically replace *value with desired if it equals expected - returns the previous value */
+long long sync_compare_swap(volatile long long* value, long long expected, long long desired) {
+    #ifdef _MSC_VER
+    return InterlockedCompareExchange64(value, desired, expected);
+    #else
+    return __sync_val_compare_and_swap(value, expected, desired);
+    #endif
+}
+
+/* Full memory barrier - no load or store moves across it */
+void sync_barrier(void) {
+    #ifdef _MSC_VER
+    MemoryBarrier();
+    #else
+    __sync_synchronize();
+    #endif
+}
+
+/* Busy-wait lock on a word that is 0 when free - for short critical sections */
+void spin_lock(volatile long long* lock) {
+    while (sync_compare_swap(lock, 0, 1) != 0) {
+        #ifdef _WIN32
+        SwitchToThread();
+        #else
+        sched_yield();
+        #endif
+    }
+}
+
+void spin_unlock(volatile long long* lock) {
+    sync_compare_swap(lock, 1, 0);
+}
+
+/* Map a whole file read-only - returns NULL on failure or for an empty file */
+const void* map_file(const char* path, size_t* size) {
+    #ifdef _WIN32
+    HANDLE file, mapping;
+    LARGE_INTEGER length;
+    const void* view;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    *size = (size_t)length.QuadPart;
+    return view;
+    #else
+    struct stat info;
+    void* view;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        return NULL;
+    }
+    *size = (size_t)info.st_size;
+    return view;
+    #endif
+}
+
+/* Release a mapping made by map_file */
+void unmap_file(const void* view, size_t size) {
+    #ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(view);
+    #else
+    munmap((void*)view, size);
+    #endif
+}
+
+/* Replace path with the finished file temp in one step - returns 0 on success */
+int replace_file(const char* temp, const char* path) {
+    #ifdef _WIN32
+    return MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+    #else
+    return rename(temp, path) == 0 ? 0 : -1;
+    #endif
+}
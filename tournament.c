@@ -0,0 +1,593 @@
+/*
+ * tournament.c - Round-robin AI tournament
+ * Cross-platform: Windows (MSVC/MinGW) and UNIVAC 1219 (GCC)
+ *
+ * Every competitor pairs a shooter (an ai_fire_salvo engine level) with a
+ * placer (a ShipPlacer such as ai_place_ship). All pairings play the same
+ * number of games, alternating who fires first. Game N of a pairing always
+ * draws from the same random stream, so a seeded tournament is reproducible
+ * whatever the thread count.
+ *
+ * The games are cut into small tasks and dealt out in contiguous blocks,
+ * one task deque per worker. A worker takes tasks from the bottom of its own
+ * deque and, once that is empty, steals from the top of the others, so the
+ * cores stay busy even when some matchups are much slower than others.
+ * With -l every game is also written to a binary game log, see gamelog.c.
+ *
+ * Usage: battleship_tour [-g GAMES] [-t THREADS] [-s SEED] [-p SHOOTERS] [-f PLACERS] [-l FILE]
+ *                        [-B SIZE] [-F SHIPS]
+ *        SHOOTERS is a comma separated list of INTERMEDIATE and ADVANCED
+ *        PLACERS is a comma separated list of UNIFORM, EDGE and CENTER
+ *        -B and -F pick the board size and fleet in a DYNAMIC_BOARD build
+ */
+
+#include "battleship.h"
+
+#define DEFAULT_GAMES 10000
+#define GAMES_PER_TASK 16
+#define MAX_THREADS 256
+#define MAX_GAME_SHOTS (2 * MAX_POSITIONS)
+
+/* A shooter - an engine level driven through ai_fire_salvo */
+typedef struct {
+    const char* name;
+    int level;
+} Shooter;
+
+/* A placer - places one ship of a fleet, see place_fleet */
+typedef struct {
+    const char* name;
+    ShipPlacer place;
+} Placer;
+
+typedef struct {
+    const Shooter* shooter;
+    const Placer* placer;
+} Competitor;
+
+/* Two competitors meeting in the round robin */
+typedef struct {
+    int side[2];
+} Pairing;
+
+/* Results of one pairing, from the point of view of side 0 and 1 */
+typedef struct {
+    long long games;
+    long long stalled;
+    long long wins[2];
+    long long win_shots[2];
+} PairStats;
+
+/* Task bounds packed into one word - low half top, high half bottom (exclusive) */
+typedef struct {
+    volatile long long range;
+} TaskDeque;
+
+typedef struct {
+    const Competitor* competitors;
+    const Pairing* pairings;
+    int pairing_count;
+    long long games_per_pair;
+    int tasks_per_pair;
+    uint64_t seed;
+    TaskDeque* deques;
+    int worker_count;
+    GameLogSink* log_sink;      /* NULL when not logging */
+} Tournament;
+
+/* Per-thread state and statistics */
+typedef struct {
+    Tournament* tournament;
+    int id;
+    PairStats* stats;       /* one block per pairing */
+    GameLogBuffer* log_buffer;
+    long long steals;
+} TourWorker;
+
+static int edge_place_ship(Player* p, int ship_index, RandomStream* rng_state);
+static int center_place_ship(Player* p, int ship_index, RandomStream* rng_state);
+
+static const Shooter shooters[] = {
+    { "INTERMEDIATE", AI_INTERMEDIATE },
+    { "ADVANCED", AI_ADVANCED }
+};
+
+static const Placer placers[] = {
+    { "UNIFORM", ai_place_ship },
+    { "EDGE", edge_place_ship },
+    { "CENTER", center_place_ship }
+};
+
+#define SHOOTER_COUNT ((int)(sizeof(shooters) / sizeof(shooters[0])))
+#define PLACER_COUNT ((int)(sizeof(placers) / sizeof(placers[0])))
+#define MAX_COMPETITORS (SHOOTER_COUNT * PLACER_COUNT)
+
+static BoardMask border_mask;
+
+/* Squares on the outer ring of the board */
+static void init_border(void) {
+    int cell, row, col;
+
+    mask_clear(&border_mask);
+    for (cell = 0; cell < BOARD_CELLS; cell++) {
+        row = cell / BOARD_SIZE;
+        col = cell % BOARD_SIZE;
+        if (row == 0 || col == 0 || row == BOARD_SIZE - 1 || col == BOARD_SIZE - 1) {
+            mask_set(&border_mask, cell);
+        }
+    }
+}
+
+/* Keep the starts whose placement does (on_edge) or does not touch the border */
+static void filter_starts(BoardMask* starts, int vertical, int length, int on_edge) {
+    BoardMask kept;
+    uint64_t word;
+    int i, cell;
+
+    mask_clear(&kept);
+    for (i = 0; i < MASK_WORDS; i++) {
+        word = starts->w[i];
+        while (word != 0) {
+            cell = i * 64 + lowest_bit(word);
+            word &= word - 1;
+            if (placement_overlaps(&border_mask, vertical, length, cell) == on_edge) {
+                mask_set(&kept, cell);
+            }
+        }
+    }
+    *starts = kept;
+}
+
+/* Uniform among the legal placements on (or off) the border, any legal one if there are none */
+static int biased_place_ship(Player* p, int ship_index, RandomStream* rng_state, int on_edge) {
+    BoardMask horizontal, vertical, all_horizontal, all_vertical;
+    int ship_len = p->ships[ship_index].length;
+    int horizontal_count, total, pick, cell;
+    int row, col;
+
+    legal_starts(&p->arena.ships, ship_len, &all_horizontal, &all_vertical);
+    horizontal = all_horizontal;
+    vertical = all_vertical;
+    filter_starts(&horizontal, 0, ship_len, on_edge);
+    filter_starts(&vertical, 1, ship_len, on_edge);
+    if (mask_is_empty(&horizontal) && mask_is_empty(&vertical)) {
+        horizontal = all_horizontal;
+        vertical = all_vertical;
+    }
+
+    horizontal_count = mask_popcount(&horizontal);
+    total = horizontal_count + mask_popcount(&vertical);
+    if (total == 0) {
+        return NO_ROOM;
+    }
+
+    pick = random_range(rng_state, 0, total - 1);
+    if (pick < horizontal_count) {
+        cell = mask_select(&horizontal, pick);
+        row = cell_row(cell);
+        col = cell_col(cell);
+        place_ship(p, ship_index, row, row, col, col + ship_len - 1);
+    } else {
+        cell = mask_select(&vertical, pick - horizontal_count);
+        row = cell_row(cell);
+        col = cell_col(cell);
+        place_ship(p, ship_index, row, row + ship_len - 1, col, col);
+    }
+    return VALID_COORD;
+}
+
+/* Hug the edges of the board */
+static int edge_place_ship(Player* p, int ship_index, RandomStream* rng_state) {
+    return biased_place_ship(p, ship_index, rng_state, 1);
+}
+
+/* Keep away from the edges of the board */
+static int center_place_ship(Player* p, int ship_index, RandomStream* rng_state) {
+    return biased_place_ship(p, ship_index, rng_state, 0);
+}
+
+/* Play one game, returns winning side (0 or 1) or -1 if the game stalled */
+static int play_match(const Competitor* const* sides, int first, RandomStream* rng_state, int* winner_shots,
+    GameLog* log) {
+    Player side[2];
+    IntermediateAI engine[2];
+    GameObserver recorder;
+    Game game;
+    ShotReport report;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        init_player(&side[i], i == 0 ? "SIDE ONE" : "SIDE TWO");
+        if (place_fleet(&side[i], sides[i]->placer->place, rng_state) != VALID_COORD) {
+            return -1;
+        }
+        if (sides[i]->shooter->level == AI_ADVANCED) {
+            init_advanced_ai(&engine[i]);
+        } else {
+            init_intermediate_ai(&engine[i]);
+        }
+        if (log != NULL) {
+            game_log_fleet(log, i, &side[i]);
+        }
+    }
+
+    recorder.shot = game_log_observe;
+    recorder.game_over = NULL;
+    recorder.context = log;
+    game_begin(&game, &side[0], &engine[0], &side[1], &engine[1], first, log != NULL ? &recorder : NULL);
+    while (game.winner < 0 && game.shots[0] + game.shots[1] < 2 * MAX_GAME_SHOTS) {
+        game_engine_fire(&game, rng_state, &report);
+    }
+
+    if (game.winner >= 0) {
+        *winner_shots = game.shots[game.winner];
+    }
+    return game.winner;
+}
+
+static long long pack_range(long long top, long long bottom) {
+    return (long long)(((uint64_t)bottom << 32) | (uint64_t)top);
+}
+
+/* Claim a task from the top (thieves) or bottom (owner) of a deque, -1 if empty */
+static long long claim_task(TaskDeque* d, int from_top) {
+    long long old, desired, top, bottom;
+
+    while (1) {
+        old = d->range;
+        top = (long long)((uint64_t)old & 0xFFFFFFFFu);
+        bottom = (long long)((uint64_t)old >> 32);
+        if (top >= bottom) {
+            return -1;
+        }
+        desired = from_top ? pack_range(top + 1, bottom) : pack_range(top, bottom - 1);
+        if (sync_compare_swap(&d->range, old, desired) == old) {
+            return from_top ? top : bottom - 1;
+        }
+    }
+}
+
+/* Play the games of one task */
+static void run_task(TourWorker* w, long long task) {
+    Tournament* t = w->tournament;
+    int pairing = (int)(task / t->tasks_per_pair);
+    long long start = (task % t->tasks_per_pair) * GAMES_PER_TASK;
+    long long end = start + GAMES_PER_TASK;
+    const Competitor* sides[2];
+    PairStats* stats = &w->stats[pairing];
+    RandomStream rng;
+    GameLog log;
+    GameLog* game_log = w->log_buffer != NULL ? &log : NULL;
+    uint64_t game;
+    long long g;
+    int winner, shots;
+
+    if (end > t->games_per_pair) {
+        end = t->games_per_pair;
+    }
+    sides[0] = &t->competitors[t->pairings[pairing].side[0]];
+    sides[1] = &t->competitors[t->pairings[pairing].side[1]];
+
+    for (g = start; g < end; g++) {
+        game = (uint64_t)pairing * (uint64_t)t->games_per_pair + (uint64_t)g;
+        random_stream(&rng, t->seed, game);
+        if (game_log != NULL) {
+            game_log_begin(game_log, t->seed, game, (int)(g & 1),
+                sides[0]->shooter->level, sides[1]->shooter->level);
+        }
+        shots = 0;
+        winner = play_match(sides, (int)(g & 1), &rng, &shots, game_log);
+        if (game_log != NULL) {
+            game_log_finish(game_log, winner);
+            game_log_buffer_add(w->log_buffer, game_log);
+        }
+        stats->games++;
+        if (winner < 0) {
+            stats->stalled++;
+            continue;
+        }
+        stats->wins[winner]++;
+        stats->win_shots[winner] += shots;
+    }
+}
+
+/* Worker loop - own deque first, then steal until every deque is empty */
+static void tour_worker(void* arg) {
+    TourWorker* w = (TourWorker*)arg;
+    Tournament* t = w->tournament;
+    long long task;
+    int k;
+
+    while (1) {
+        task = claim_task(&t->deques[w->id], 0);
+        for (k = 1; task < 0 && k < t->worker_count; k++) {
+            task = claim_task(&t->deques[(w->id + k) % t->worker_count], 1);
+            if (task >= 0) {
+                w->steals++;
+            }
+        }
+        /* No task is ever added, so empty deques stay empty */
+        if (task < 0) {
+            break;
+        }
+        run_task(w, task);
+    }
+}
+
+/* Parse a comma separated list of names by their first letter - returns the count */
+static int parse_list(const char* list, const char* const* names, int name_count, int* picked) {
+    int count = 0;
+    int i;
+    const char* p = list;
+
+    while (*p != '\0') {
+        for (i = 0; i < name_count; i++) {
+            if ((*p | 0x20) == (names[i][0] | 0x20)) {
+                picked[count++] = i;
+                break;
+            }
+        }
+        if (i == name_count) {
+            return -1;
+        }
+        while (*p != '\0' && *p != ',') p++;
+        if (*p == ',') p++;
+        if (count == name_count) break;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    static const char* shooter_names[SHOOTER_COUNT];
+    static const char* placer_names[PLACER_COUNT];
+    Competitor competitors[MAX_COMPETITORS];
+    Pairing pairings[MAX_COMPETITORS * MAX_COMPETITORS];
+    long long wins[MAX_COMPETITORS][MAX_COMPETITORS];
+    long long games_against[MAX_COMPETITORS][MAX_COMPETITORS];
+    long long win_shots[MAX_COMPETITORS][MAX_COMPETITORS];
+    int shooter_picks[SHOOTER_COUNT], placer_picks[PLACER_COUNT];
+    int shooter_count = SHOOTER_COUNT, placer_count = PLACER_COUNT;
+    int competitor_count = 0, pairing_count = 0;
+    Tournament tournament;
+    TourWorker* workers;
+    ThreadHandle threads[MAX_THREADS];
+    GameLogSink log_sink;
+    const char* log_path = NULL;
+    uint64_t seed = 0;
+    int seeded = 0;
+    int thread_count = cpu_count();
+    int board_option = BOARD_SIZE, ships_option = NO_OF_SHIPS;
+    long long games = DEFAULT_GAMES;
+    long long task_count, total_games = 0, stalled = 0, steals = 0, won, played;
+    double started, elapsed;
+    int i, j, a, b;
+    PairStats* s;
+
+    for (i = 0; i < SHOOTER_COUNT; i++) {
+        shooter_names[i] = shooters[i].name;
+        shooter_picks[i] = i;
+    }
+    for (i = 0; i < PLACER_COUNT; i++) {
+        placer_names[i] = placers[i].name;
+        placer_picks[i] = i;
+    }
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            games = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = (uint64_t)strtoull(argv[++i], NULL, 10);
+            seeded = 1;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            shooter_count = parse_list(argv[++i], shooter_names, SHOOTER_COUNT, shooter_picks);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            placer_count = parse_list(argv[++i], placer_names, PLACER_COUNT, placer_picks);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            board_option = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            ships_option = atoi(argv[++i]);
+        } else {
+            shooter_count = -1;
+        }
+        if (shooter_count < 1 || placer_count < 1) {
+            fprintf(stderr, "USAGE: %s [-g GAMES] [-t THREADS] [-s SEED] [-p SHOOTERS] [-f PLACERS] [-l FILE]"
+                " [-B SIZE] [-F SHIPS]\n", argv[0]);
+            fprintf(stderr, "SHOOTERS: INTERMEDIATE,ADVANCED  PLACERS: UNIFORM,EDGE,CENTER\n");
+            return 1;
+        }
+    }
+
+    if (configure_board(board_option, ships_option) != 0) {
+        fprintf(stderr, "THIS BUILD CANNOT PLAY %dX%d WITH %d SHIPS\n", board_option, board_option, ships_option);
+        return 1;
+    }
+    if (log_path != NULL && !game_log_supported()) {
+        fprintf(stderr, "GAME LOGS HOLD BOARDS OF AT MOST %d SQUARES\n", GAME_LOG_NO_SHOT);
+        return 1;
+    }
+    if (games < 1) games = 1;
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+    if (!seeded) {
+        seed = time_seed();
+    }
+
+    for (i = 0; i < shooter_count; i++) {
+        for (j = 0; j < placer_count; j++) {
+            competitors[competitor_count].shooter = &shooters[shooter_picks[i]];
+            competitors[competitor_count].placer = &placers[placer_picks[j]];
+            competitor_count++;
+        }
+    }
+    for (a = 0; a < competitor_count; a++) {
+        for (b = a + 1; b < competitor_count; b++) {
+            pairings[pairing_count].side[0] = a;
+            pairings[pairing_count].side[1] = b;
+            pairing_count++;
+        }
+    }
+    if (pairing_count == 0) {
+        fprintf(stderr, "A TOURNAMENT NEEDS AT LEAST TWO COMPETITORS\n");
+        return 1;
+    }
+
+    tournament.competitors = competitors;
+    tournament.pairings = pairings;
+    tournament.pairing_count = pairing_count;
+    tournament.games_per_pair = games;
+    tournament.tasks_per_pair = (int)((games + GAMES_PER_TASK - 1) / GAMES_PER_TASK);
+    tournament.seed = seed;
+    tournament.worker_count = thread_count;
+    tournament.log_sink = NULL;
+    if (log_path != NULL) {
+        log_sink.file = fopen(log_path, "wb");
+        log_sink.lock = 0;
+        if (log_sink.file == NULL) {
+            fprintf(stderr, "CANNOT OPEN %s\n", log_path);
+            return 1;
+        }
+        tournament.log_sink = &log_sink;
+    }
+    task_count = (long long)pairing_count * tournament.tasks_per_pair;
+
+    workers = (TourWorker*)calloc((size_t)thread_count, sizeof(TourWorker));
+    tournament.deques = (TaskDeque*)calloc((size_t)thread_count, sizeof(TaskDeque));
+    for (i = 0; workers != NULL && i < thread_count; i++) {
+        workers[i].stats = (PairStats*)calloc((size_t)pairing_count, sizeof(PairStats));
+        if (log_path != NULL && workers[i].stats != NULL) {
+            workers[i].log_buffer = (GameLogBuffer*)calloc(1, sizeof(GameLogBuffer));
+            if (workers[i].log_buffer == NULL) {
+                free(workers[i].stats);
+                workers[i].stats = NULL;
+            } else {
+                workers[i].log_buffer->sink = &log_sink;
+            }
+        }
+        if (workers[i].stats == NULL) {
+            free(workers);
+            workers = NULL;
+        }
+    }
+    if (workers == NULL || tournament.deques == NULL) {
+        fprintf(stderr, "OUT OF MEMORY\n");
+        return 1;
+    }
+
+    /* Placement tables and kernel must be ready before workers share them */
+    init_bitboards();
+    select_placement_kernel(KERNEL_AUTO);
+    init_border();
+
+    /* Deal the tasks out in contiguous blocks, so owners mostly stay on one matchup */
+    for (i = 0; i < thread_count; i++) {
+        workers[i].tournament = &tournament;
+        workers[i].id = i;
+        tournament.deques[i].range = pack_range(task_count * i / thread_count,
+            task_count * (i + 1) / thread_count);
+    }
+
+    started = monotonic_seconds();
+    for (i = 1; i < thread_count; i++) {
+        if (thread_start(&threads[i], tour_worker, &workers[i]) != 0) {
+            fprintf(stderr, "FAILED TO START WORKER %d\n", i);
+            threads[i].impl = NULL;
+        }
+    }
+    tour_worker(&workers[0]);
+    for (i = 1; i < thread_count; i++) {
+        thread_join(&threads[i]);
+    }
+    elapsed = monotonic_seconds() - started;
+
+    /* Merge per-thread statistics into row-against-column matrices */
+    memset(wins, 0, sizeof(wins));
+    memset(games_against, 0, sizeof(games_against));
+    memset(win_shots, 0, sizeof(win_shots));
+    for (i = 0; i < thread_count; i++) {
+        steals += workers[i].steals;
+        for (j = 0; j < pairing_count; j++) {
+            s = &workers[i].stats[j];
+            a = pairings[j].side[0];
+            b = pairings[j].side[1];
+            total_games += s->games;
+            stalled += s->stalled;
+            games_against[a][b] += s->games - s->stalled;
+            games_against[b][a] += s->games - s->stalled;
+            wins[a][b] += s->wins[0];
+            wins[b][a] += s->wins[1];
+            win_shots[a][b] += s->win_shots[0];
+            win_shots[b][a] += s->win_shots[1];
+        }
+        free(workers[i].stats);
+        if (workers[i].log_buffer != NULL) {
+            game_log_buffer_flush(workers[i].log_buffer);
+            free(workers[i].log_buffer);
+        }
+    }
+    free(workers);
+    free(tournament.deques);
+    if (tournament.log_sink != NULL) {
+        fclose(log_sink.file);
+    }
+
+    printf("========================================\n");
+    printf("   BATTLESHIP - ROUND-ROBIN TOURNAMENT\n");
+    printf("   PLATFORM: %s\n", PLATFORM_NAME);
+    printf("========================================\n");
+    printf("SEED:            %llu\n", (unsigned long long)seed);
+    printf("THREADS:         %d\n", thread_count);
+    printf("PAIRINGS:        %d X %lld GAMES\n", pairing_count, games);
+    printf("BOARD:           %dX%d, %d SHIPS\n", BOARD_SIZE, BOARD_SIZE, NO_OF_SHIPS);
+    printf("STALLED GAMES:   %lld\n", stalled);
+    printf("TASKS STOLEN:    %lld OF %lld\n", steals, task_count);
+    printf("ELAPSED:         %.3f S\n", elapsed);
+    printf("GAMES/SEC:       %.0f\n", elapsed > 0.0 ? (double)total_games / elapsed : 0.0);
+
+    printf("\nCOMPETITORS:\n");
+    for (a = 0; a < competitor_count; a++) {
+        won = 0;
+        played = 0;
+        for (b = 0; b < competitor_count; b++) {
+            won += wins[a][b];
+            played += games_against[a][b];
+        }
+        printf("%3d  %-12s / %-8s  WINS %6.2f%%\n", a + 1, competitors[a].shooter->name,
+            competitors[a].placer->name, played > 0 ? 100.0 * (double)won / (double)played : 0.0);
+    }
+
+    printf("\nWIN RATE %% (ROW AGAINST COLUMN):\n     ");
+    for (b = 0; b < competitor_count; b++) printf("%8d", b + 1);
+    printf("\n");
+    for (a = 0; a < competitor_count; a++) {
+        printf("%3d  ", a + 1);
+        for (b = 0; b < competitor_count; b++) {
+            if (a == b || games_against[a][b] == 0) {
+                printf("%8s", "-");
+            } else {
+                printf("%8.2f", 100.0 * (double)wins[a][b] / (double)games_against[a][b]);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("\nMEAN SHOTS TO WIN (ROW AGAINST COLUMN):\n     ");
+    for (b = 0; b < competitor_count; b++) printf("%8d", b + 1);
+    printf("\n");
+    for (a = 0; a < competitor_count; a++) {
+        printf("%3d  ", a + 1);
+        for (b = 0; b < competitor_count; b++) {
+            if (a == b || wins[a][b] == 0) {
+                printf("%8s", "-");
+            } else {
+                printf("%8.2f", (double)win_shots[a][b] / (double)wins[a][b]);
+            }
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -1,50 +1,69 @@
 /*
  * utils.c - Utility functions for Battleship game
- * Cross-platform compatible with XorShift RNG for UNIVAC
+ * Cross-platform compatible with a seedable xoshiro256** RNG
  */
 
 #include "battleship.h"
 
-/* XorShift32 random number generator - works on all platforms */
-unsigned int xorshift32(unsigned int* state) {
-    unsigned int x = *state;
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    *state = x;
-    return x;
+/* SplitMix64 step - expands seeds into generator state */
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-/* Initialize random number generator with time(0) */
-void init_random(unsigned int* state) {
+/* Seed from the clock - for runs that need not be reproducible */
+uint64_t time_seed(void) {
     #ifdef UNIVAC
     /* UNIVAC: Use time(0) XOR'd with a constant for better distribution */
-    *state = (unsigned int)time(NULL) ^ 0x5EED5EED;
+    return (uint64_t)time(NULL) ^ 0x5EED5EED;
     #else
-    /* Windows: Can use time(0) or more sophisticated seeding */
-    *state = (unsigned int)time(NULL);
+    return (uint64_t)time(NULL);
     #endif
-    
-    /* Warm up the RNG */
-    xorshift32(state);
-    xorshift32(state);
-    xorshift32(state);
+}
+
+/* Seed a generator - equal seeds give equal sequences on every platform */
+void random_seed(RandomStream* rng, uint64_t seed) {
+    int i;
+    for (i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+/* Seed stream number index of a seed - streams of one seed are independent */
+void random_stream(RandomStream* rng, uint64_t seed, uint64_t index) {
+    uint64_t key = seed;
+    uint64_t x = splitmix64(&key) ^ (index * 0xD1B54A32D192ED03ULL);
+    int i;
+    for (i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&x);
+    }
+}
+
+/* Derive an independent child generator, advancing the parent */
+void random_split(RandomStream* parent, RandomStream* child) {
+    random_seed(child, random_next(parent));
+}
+
+/* Initialize random number generator with time(0) */
+void init_random(RandomStream* rng) {
+    random_seed(rng, time_seed());
 }
 
 /* Generate random number in range [min, max] inclusive */
-int random_range(unsigned int* state, int min, int max) {
-    unsigned int r = xorshift32(state);
-    return min + (r % (max - min + 1));
+int random_range(RandomStream* rng, int min, int max) {
+    return min + (int)random_below(rng, (uint32_t)(max - min) + 1u);
 }
 
-/* Generate random row ('A' to 'J') */
-char random_row(unsigned int* state) {
-    return 'A' + (char)random_range(state, 0, 9);
+/* Generate random row code ('A' to the last row) */
+int random_row(RandomStream* rng) {
+    return 'A' + random_range(rng, 0, BOARD_SIZE - 1);
 }
 
-/* Generate random column (1 to 10) */
-int random_col(unsigned int* state) {
-    return random_range(state, 1, 10);
+/* Generate random column (1 to BOARD_SIZE) */
+int random_col(RandomStream* rng) {
+    return random_range(rng, 1, BOARD_SIZE);
 }
 
 /* Clear the screen - platform dependent */
@@ -100,14 +119,13 @@ void get_input(char* buffer, int size) {
 }
 
 /* Normalize coordinates so first is always <= second */
-void normalize_coordinates(char* roF, char* roS, int* coF, int* coS) {
-    char temp_char;
+void normalize_coordinates(int* roF, int* roS, int* coF, int* coS) {
     int temp_int;
     
     if (*roF > *roS) {
-        temp_char = *roF;
+        temp_int = *roF;
         *roF = *roS;
-        *roS = temp_char;
+        *roS = temp_int;
     }
     
     if (*coF > *coS) {